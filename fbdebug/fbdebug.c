@@ -31,6 +31,7 @@
 #include <nuttx/video/fb.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <time.h>
@@ -68,6 +69,115 @@ struct fb_state_s
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * fb_write_png
+ *
+ * Description:
+ *   Encode the w x h area starting at fb to a PNG file one row at a time.
+ *   Rows are converted from the framebuffer into a single row buffer, so
+ *   the memory needed does not depend on the area height.
+ *
+ ****************************************************************************/
+
+static int fb_write_png(FAR struct fb_state_s *state, FAR const uint8_t *fb,
+                        int w, int h, FAR const char *path)
+{
+  FAR png_structp png;
+  FAR png_infop info;
+  FAR uint8_t *row;
+  FAR FILE *file;
+  int bytes = state->pinfo.bpp >> 3;
+  int ret = -ENOMEM;
+
+  file = fopen(path, "wb");
+  if (file == NULL)
+    {
+      return -errno;
+    }
+
+  row = malloc(w * bytes);
+  if (row == NULL)
+    {
+      goto errout_with_file;
+    }
+
+  png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (png == NULL)
+    {
+      goto errout_with_row;
+    }
+
+  info = png_create_info_struct(png);
+  if (info == NULL)
+    {
+      png_destroy_write_struct(&png, NULL);
+      goto errout_with_row;
+    }
+
+  /* libpng reports write and encoder errors by longjmp() back here */
+
+  if (setjmp(png_jmpbuf(png)))
+    {
+      ret = -EIO;
+      goto errout_with_png;
+    }
+
+  png_init_io(png, file);
+  png_set_IHDR(png, info, w, h, 8,
+               bytes == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  for (int i = 0; i < h; i++)
+    {
+      /* The framebuffer is BGR(A) in memory unless the panel swaps R & B */
+
+#ifdef CONFIG_PYXIS_FBDEBUG_SWAPRB
+      memcpy(row, fb, w * bytes);
+#else
+      if (bytes == 4)
+        {
+          FAR const uint32_t *src = (FAR const uint32_t *)fb;
+          FAR uint32_t *dst = (FAR uint32_t *)row;
+
+          for (int j = 0; j < w; j++)
+            {
+              dst[j] = BGRA_TO_RGBA(src[j]);
+            }
+        }
+      else
+        {
+          for (int j = 0; j < w * 3; j += 3)
+            {
+              row[j]     = fb[j + 2];
+              row[j + 1] = fb[j + 1];
+              row[j + 2] = fb[j];
+            }
+        }
+#endif
+
+      png_write_row(png, row);
+      fb += state->pinfo.stride;
+    }
+
+  png_write_end(png, NULL);
+  ret = OK;
+
+errout_with_png:
+  png_destroy_write_struct(&png, &info);
+errout_with_row:
+  free(row);
+errout_with_file:
+  fclose(file);
+  if (ret < 0)
+    {
+      unlink(path);
+    }
+
+  return ret;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -262,48 +372,14 @@ int main(int argc, FAR char *argv[])
             fb += state.pinfo.stride;
             printf("\n");
           }
-      else if (state.pinfo.bpp == 32 || state.pinfo.bpp == 24 || w * h > 0)
+      else if ((state.pinfo.bpp == 32 || state.pinfo.bpp == 24) && w * h > 0)
         {
-          int ROI_stride = w * state.pinfo.bpp >> 3;
-          int ROI_len = ROI_stride * h;
-          void* roi = malloc(ROI_len);
-          if (!roi)
-            goto Error_handler;
-          for (int i = 0; i < h; i++)
-            {
-#ifdef CONFIG_PYXIS_FBDEBUG_SWAPRB
-              uint32_t* troi = roi + i * ROI_stride;
-              uint32_t* tfb = (uint32_t*)(fb + i * state.pinfo.stride);
-              for (int j = 0; j < w; j++)
-                {
-                  troi[j] = BGRA_TO_RGBA(tfb[j]);
-                }
-#else
-              memcpy(roi + i * ROI_stride, fb + i * state.pinfo.stride, ROI_stride);
-#endif
-            }
-
           if (out_path)
             {
-              png_image image;
-              int error;
-
-              /* Construct the PNG image structure. */
-
-              memset(&image, 0, sizeof(image));
-
-              image.version = PNG_IMAGE_VERSION;
-              image.width   = w;
-              image.height  = h;
-              image.format  = state.pinfo.bpp == 24 ? PNG_FORMAT_BGR : PNG_FORMAT_BGRA;
-
-              /* Write the PNG image. */
-
-              error = png_image_write_to_file(&image, out_path, 0, state.fbmem,
-                                              state.pinfo.stride, NULL);
-              if (error < 0)
+              ret = fb_write_png(&state, fb, w, h, out_path);
+              if (ret < 0)
                 {
-                  printf("Write file to %s failed: %d\n", out_path, error);
+                  printf("Write file to %s failed: %d\n", out_path, ret);
                 }
               else
                 {
@@ -314,13 +390,12 @@ int main(int argc, FAR char *argv[])
             {
               /* TODO:base64str = base64_encode(png, pngsize, NULL, NULL); */
             }
-          free(roi);
           if (base64str)
             printf("FB [%d,%d](%d,%d) in base64:%s\n", x, y, w, h, base64str);
         }
-      else if (state.pinfo.bpp != 32)
+      else if (state.pinfo.bpp != 32 && state.pinfo.bpp != 24)
         {
-          printf("Encoded output only supports 32bpp FB\n");
+          printf("Encoded output only supports 32bpp and 24bpp FB\n");
         }
       else
         {
@@ -426,7 +501,6 @@ int main(int argc, FAR char *argv[])
         fb += state.pinfo.stride;
       }
     }
-Error_handler:
   munmap(state.fbmem, state.pinfo.fblen);
   close(state.fd);
   return EXIT_SUCCESS;
@@ -0,0 +1,351 @@
+/****************************************************************************
+ * apps/system/sysmon/bench.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "bench.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP_NCPUS
+#  define BENCH_NCPUS CONFIG_SMP_NCPUS
+#else
+#  define BENCH_NCPUS 1
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The nodes of every task directory */
+
+static FAR const char * const g_bench_tasknodes[] =
+{
+  "status", "stack", "critmon", "loadavg"
+};
+
+/* The nodes at the top of the tree */
+
+static FAR const char * const g_bench_nodes[] =
+{
+  "critmon", "cpuload", "meminfo", "irqs", "iobinfo",
+  "self/stack", "self/loadavg"
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bench_write
+ *
+ * Description:
+ *   Replace the content of root/node with the formatted text.
+ *
+ ****************************************************************************/
+
+static int bench_write(FAR const char *root, FAR const char *node,
+                       FAR const char *fmt, ...)
+{
+  char path[PATH_MAX];
+  char buf[128];
+  va_list ap;
+  int len;
+  int ret;
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/%s", root, node);
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  va_start(ap, fmt);
+  len = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+
+  ret = write(fd, buf, len) == len ? OK : -errno;
+  close(fd);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bench_append
+ *
+ * Description:
+ *   Open root/node for bench_line(), truncating it.
+ *
+ ****************************************************************************/
+
+static int bench_append(FAR const char *root, FAR const char *node)
+{
+  char path[PATH_MAX];
+
+  snprintf(path, sizeof(path), "%s/%s", root, node);
+  return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+}
+
+/****************************************************************************
+ * Name: bench_line
+ *
+ * Description:
+ *   Append the formatted text to a node opened by bench_append().  Returns
+ *   OK or a negated errno.
+ *
+ ****************************************************************************/
+
+static int bench_line(int fd, FAR const char *fmt, ...)
+{
+  char buf[128];
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+
+  return write(fd, buf, len) == len ? OK : -errno;
+}
+
+/****************************************************************************
+ * Name: bench_task
+ *
+ * Description:
+ *   Create the directory of one task.  The numbers are derived from the
+ *   pid so the tasks differ from each other.
+ *
+ ****************************************************************************/
+
+static int bench_task(FAR const char *root, int pid)
+{
+  char dir[PATH_MAX];
+  int size = 2048 + (pid % 4) * 1024;
+  int ret;
+
+  snprintf(dir, sizeof(dir), "%s/%d", root, pid);
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+    {
+      return -errno;
+    }
+
+  ret = bench_write(dir, "status",
+                    "Name:\tbench%d\n"
+                    "Type:\tTask\n"
+                    "State:\tWaiting\n"
+                    "Priority:\t%d\n"
+                    "Scheduler:\tSCHED_FIFO\n",
+                    pid, 100 + pid % 100);
+  if (ret >= 0)
+    {
+      ret = bench_write(dir, "stack",
+                        "StackAlloc: 0x%08x\n"
+                        "StackBase:  0x%08x\n"
+                        "StackSize:  %d\n"
+                        "MaxStackUsed: %d\n",
+                        0x20000000 + pid * 0x1000,
+                        0x20000000 + pid * 0x1000, size,
+                        size / 2 + pid * 16 % (size / 2));
+    }
+
+  if (ret >= 0)
+    {
+      ret = bench_write(dir, "critmon", "0.%09d,0.%09d,0.%09d,%d.%09d\n",
+                        (pid * 7919) % 200000, (pid * 104729) % 400000,
+                        (pid * 1299709) % 1000000, pid, pid * 1000);
+    }
+
+  if (ret >= 0)
+    {
+      ret = bench_write(dir, "loadavg", "  %2d.%d%%\n",
+                        pid % 10, pid % 7);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_bench_tree
+ ****************************************************************************/
+
+int sysmon_bench_tree(FAR const char *root, int ntasks, int nirqs,
+                      int nheaps)
+{
+  char dir[PATH_MAX];
+  int ret;
+  int fd;
+  int i;
+
+  if (mkdir(root, 0777) < 0 && errno != EEXIST)
+    {
+      return -errno;
+    }
+
+  snprintf(dir, sizeof(dir), "%s/self", root);
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+    {
+      return -errno;
+    }
+
+  /* Global nodes */
+
+  fd = bench_append(root, "critmon");
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  ret = OK;
+  for (i = 0; ret >= 0 && i < BENCH_NCPUS; i++)
+    {
+      ret = bench_line(fd, "%d,0.%09d,0.%09d\n", i, 12000 + i, 34000 + i);
+    }
+
+  close(fd);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  fd = bench_append(root, "meminfo");
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  ret = bench_line(fd, "%13s%11s%11s%11s%11s%7s%7s %s\n", "total", "used",
+                   "free", "maxused", "maxfree", "nused", "nfree", "name");
+  for (i = 0; ret >= 0 && i < nheaps; i++)
+    {
+      long total = 262144L << (i % 3);
+      long used = total / 3 + i * 512;
+
+      ret = bench_line(fd, "%13ld%11ld%11ld%11ld%11ld%7d%7d %s%d\n",
+                       total, used, total - used, used + 1024,
+                       (total - used) / 2, 100 + i, 4 + i, "heap", i);
+    }
+
+  close(fd);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  fd = bench_append(root, "irqs");
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  ret = bench_line(fd, "IRQ HANDLER  ARGUMENT    COUNT    RATE    TIME\n");
+  for (i = 0; ret >= 0 && i < nirqs; i++)
+    {
+      ret = bench_line(fd, "%3d %08x %08x %10d %4d.%03d %7d\n", 16 + i,
+                       0x08000000 + i * 0x40, 0, i * 1000, i % 100,
+                       i % 1000, i);
+    }
+
+  close(fd);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = bench_write(root, "cpuload", "  12.5%%\n");
+  if (ret >= 0)
+    {
+      ret = bench_write(root, "iobinfo",
+                        "    ntotal     nfree     nwait nthrottle\n"
+                        "%10d%10d%10d%10d\n", 24, 20, 0, 0);
+    }
+
+  if (ret >= 0)
+    {
+      ret = bench_write(root, "self/stack", "StackSize:  2048\n");
+    }
+
+  if (ret >= 0)
+    {
+      ret = bench_write(root, "self/loadavg", "   0.0%%\n");
+    }
+
+  /* Task directories */
+
+  for (i = 0; ret >= 0 && i < ntasks; i++)
+    {
+      ret = bench_task(root, i);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_bench_clean
+ ****************************************************************************/
+
+void sysmon_bench_clean(FAR const char *root, int ntasks)
+{
+  char path[PATH_MAX];
+  unsigned int j;
+  int i;
+
+  for (i = 0; i < ntasks; i++)
+    {
+      for (j = 0; j < sizeof(g_bench_tasknodes) /
+                      sizeof(g_bench_tasknodes[0]); j++)
+        {
+          snprintf(path, sizeof(path), "%s/%d/%s", root, i,
+                   g_bench_tasknodes[j]);
+          unlink(path);
+        }
+
+      snprintf(path, sizeof(path), "%s/%d", root, i);
+      rmdir(path);
+    }
+
+  for (j = 0; j < sizeof(g_bench_nodes) / sizeof(g_bench_nodes[0]); j++)
+    {
+      snprintf(path, sizeof(path), "%s/%s", root, g_bench_nodes[j]);
+      unlink(path);
+    }
+
+  snprintf(path, sizeof(path), "%s/self", root);
+  rmdir(path);
+  rmdir(root);
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+ * apps/system/sysmon/bench.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __VELA_PYXIS_SYSMON_BENCH_H
+#define __VELA_PYXIS_SYSMON_BENCH_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_BENCH
+
+/****************************************************************************
+ * Name: sysmon_bench_tree
+ *
+ * Description:
+ *   Populate root with a synthetic procfs tree: the global critmon,
+ *   cpuload, meminfo, irqs and iobinfo nodes with nheaps heaps and nirqs
+ *   interrupts, and ntasks task directories with their status, stack,
+ *   critmon and loadavg nodes.  The tree can be grown by calling it again
+ *   with more tasks.  Returns OK or a negated errno.
+ *
+ ****************************************************************************/
+
+int sysmon_bench_tree(FAR const char *root, int ntasks, int nirqs,
+                      int nheaps);
+
+/****************************************************************************
+ * Name: sysmon_bench_clean
+ *
+ * Description:
+ *   Remove a tree created by sysmon_bench_tree() with ntasks tasks.
+ *
+ ****************************************************************************/
+
+void sysmon_bench_clean(FAR const char *root, int ntasks);
+
+#endif /* CONFIG_PYXIS_SYSMON_BENCH */
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELA_PYXIS_SYSMON_BENCH_H */
@@ -0,0 +1,858 @@
+/****************************************************************************
+ * apps/system/sysmon/profile.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef CONFIG_ALLSYMS
+#  include <nuttx/allsyms.h>
+#endif
+
+#include "profile.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_PYXIS_SYSMON_MOUNTPOINT
+#  define CONFIG_PYXIS_SYSMON_MOUNTPOINT "/proc"
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_MAX_TASKS
+#  define CONFIG_PYXIS_SYSMON_MAX_TASKS 32
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_RATE
+#  define CONFIG_PYXIS_SYSMON_PROFILE_RATE 100
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_DEPTH
+#  define CONFIG_PYXIS_SYSMON_PROFILE_DEPTH 4
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_STACKS
+#  define CONFIG_PYXIS_SYSMON_PROFILE_STACKS 256
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_NHOT
+#  define CONFIG_PYXIS_SYSMON_PROFILE_NHOT 5
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_PATH
+#  define CONFIG_PYXIS_SYSMON_PROFILE_PATH "/tmp/sysmon.folded"
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_PATH_SIZE
+#  define CONFIG_PYXIS_SYSMON_PROFILE_PATH_SIZE 65536
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_PRIORITY
+#  define CONFIG_PYXIS_SYSMON_PROFILE_PRIORITY 240
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PROFILE_STACKSIZE
+#  define CONFIG_PYXIS_SYSMON_PROFILE_STACKSIZE 2048
+#endif
+
+#define PROFILE_NAMESIZE   16
+#define PROFILE_NFUNCS     64     /* Distinct functions ranked per task */
+#define PROFILE_SCAN       1000   /* Task list refresh period in ms */
+
+#define NSEC_PER_SEC       1000000000ull
+#define NSEC_PER_MSEC      1000000ull
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One distinct stack and how many samples hit it.  frames[0] is the PC,
+ * count 0 marks a free slot of the hash table.
+ */
+
+struct profile_stack_s
+{
+  pid_t pid;
+  uint32_t count;
+  uint16_t depth;
+  uintptr_t frames[CONFIG_PYXIS_SYSMON_PROFILE_DEPTH];
+};
+
+/* The sampler fills one table while the collector drains the other */
+
+struct profile_table_s
+{
+  unsigned int nstacks;
+  unsigned long nsamples;
+  unsigned long ndropped;         /* Samples of new stacks, table full */
+  struct profile_stack_s stacks[CONFIG_PYXIS_SYSMON_PROFILE_STACKS];
+};
+
+/* A task watched by the sampler, fd stays open on <pid>/status.  The
+ * sampler changes pid, fd and name under the lock, the collector reads
+ * the names.
+ */
+
+struct profile_task_s
+{
+  pid_t pid;
+  int fd;
+  bool seen;
+  char name[PROFILE_NAMESIZE];
+};
+
+/* A function and its samples, while ranking the hot functions */
+
+struct profile_func_s
+{
+  uintptr_t addr;
+  FAR const char *name;
+  unsigned long count;
+};
+
+struct profile_s
+{
+  volatile bool started;
+  volatile bool stop;
+  pid_t pid;
+  pthread_mutex_t lock;           /* Guards active and the task names */
+  unsigned int active;            /* Table the sampler fills */
+  DIR *dir;
+  uint64_t nextscan;
+  struct profile_task_s tasks[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+  struct profile_table_s tables[2];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct profile_s g_profile =
+{
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: profile_clock
+ ****************************************************************************/
+
+static uint64_t profile_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: profile_field
+ *
+ * Description:
+ *   Return the value of "<field>:" in a status buffer, NULL if missing.
+ *
+ ****************************************************************************/
+
+static FAR const char *profile_field(FAR const char *buf,
+                                     FAR const char *field)
+{
+  FAR const char *value = strstr(buf, field);
+
+  if (value == NULL)
+    {
+      return NULL;
+    }
+
+  value += strlen(field);
+  while (*value == ' ' || *value == '\t')
+    {
+      value++;
+    }
+
+  return value;
+}
+
+/****************************************************************************
+ * Name: profile_scan
+ *
+ * Description:
+ *   Refresh the task list, open the status node of the new tasks and
+ *   close that of the tasks that went away.
+ *
+ ****************************************************************************/
+
+static void profile_scan(void)
+{
+  FAR struct profile_task_s *task;
+  FAR struct dirent *entryp;
+  FAR const char *name;
+  char taskname[PROFILE_NAMESIZE];
+  char path[64];
+  char buf[64];
+  pid_t pid;
+  ssize_t n;
+  int fd;
+  int i;
+
+  if (g_profile.dir == NULL)
+    {
+      g_profile.dir = opendir(CONFIG_PYXIS_SYSMON_MOUNTPOINT);
+      if (g_profile.dir == NULL)
+        {
+          return;
+        }
+    }
+  else
+    {
+      rewinddir(g_profile.dir);
+    }
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      g_profile.tasks[i].seen = false;
+    }
+
+  while ((entryp = readdir(g_profile.dir)) != NULL)
+    {
+      if (entryp->d_name[0] < '0' || entryp->d_name[0] > '9')
+        {
+          continue;
+        }
+
+      pid = atoi(entryp->d_name);
+      task = NULL;
+      for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+        {
+          if (g_profile.tasks[i].fd >= 0 && g_profile.tasks[i].pid == pid)
+            {
+              task = &g_profile.tasks[i];
+              break;
+            }
+          else if (g_profile.tasks[i].fd < 0 && task == NULL)
+            {
+              task = &g_profile.tasks[i];
+            }
+        }
+
+      if (task == NULL)
+        {
+          /* The table is full, the task is left out */
+
+          continue;
+        }
+
+      if (task->fd < 0)
+        {
+          snprintf(path, sizeof(path), CONFIG_PYXIS_SYSMON_MOUNTPOINT
+                   "/%s/status", entryp->d_name);
+          fd = open(path, O_RDONLY);
+          if (fd < 0)
+            {
+              continue;
+            }
+
+          taskname[0] = '\0';
+          n = pread(fd, buf, sizeof(buf) - 1, 0);
+          if (n > 0)
+            {
+              buf[n] = '\0';
+              name = profile_field(buf, "Name:");
+              if (name != NULL)
+                {
+                  strlcpy(taskname, name, sizeof(taskname));
+                  taskname[strcspn(taskname, "\n")] = '\0';
+                }
+            }
+
+          pthread_mutex_lock(&g_profile.lock);
+          task->fd = fd;
+          task->pid = pid;
+          strlcpy(task->name, taskname, sizeof(task->name));
+          pthread_mutex_unlock(&g_profile.lock);
+        }
+
+      task->seen = true;
+    }
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      task = &g_profile.tasks[i];
+      if (task->fd >= 0 && !task->seen)
+        {
+          pthread_mutex_lock(&g_profile.lock);
+          fd = task->fd;
+          task->fd = -1;
+          pthread_mutex_unlock(&g_profile.lock);
+          close(fd);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: profile_record
+ *
+ * Description:
+ *   Take the backtrace of pid and count it in the active table.
+ *
+ ****************************************************************************/
+
+static void profile_record(pid_t pid)
+{
+  FAR struct profile_table_s *table;
+  FAR struct profile_stack_s *stack;
+  FAR void *frames[CONFIG_PYXIS_SYSMON_PROFILE_DEPTH];
+  uint32_t hash = 2166136261u;
+  unsigned int slot;
+  int depth = 0;
+  int i;
+
+#ifdef CONFIG_SCHED_BACKTRACE
+  depth = sched_backtrace(pid, frames, CONFIG_PYXIS_SYSMON_PROFILE_DEPTH, 0);
+  if (depth < 0)
+    {
+      depth = 0;
+    }
+#endif
+
+  hash = (hash ^ pid) * 16777619u;
+  for (i = 0; i < depth; i++)
+    {
+      hash = (hash ^ (uintptr_t)frames[i]) * 16777619u;
+    }
+
+  pthread_mutex_lock(&g_profile.lock);
+  table = &g_profile.tables[g_profile.active];
+  table->nsamples++;
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_PROFILE_STACKS; i++)
+    {
+      slot = (hash + i) % CONFIG_PYXIS_SYSMON_PROFILE_STACKS;
+      stack = &table->stacks[slot];
+
+      if (stack->count == 0)
+        {
+          /* Keep a quarter free so the probes stay short */
+
+          if (table->nstacks >= CONFIG_PYXIS_SYSMON_PROFILE_STACKS * 3 / 4)
+            {
+              table->ndropped++;
+              break;
+            }
+
+          stack->pid = pid;
+          stack->depth = depth;
+          memcpy(stack->frames, frames, depth * sizeof(frames[0]));
+          stack->count = 1;
+          table->nstacks++;
+          break;
+        }
+
+      if (stack->pid == pid && stack->depth == depth &&
+          memcmp(stack->frames, frames, depth * sizeof(frames[0])) == 0)
+        {
+          stack->count++;
+          break;
+        }
+    }
+
+  pthread_mutex_unlock(&g_profile.lock);
+}
+
+/****************************************************************************
+ * Name: profile_sample
+ *
+ * Description:
+ *   Record the tasks that were on a CPU when the sampler woke up.  Those on
+ *   the other CPUs are Running.  The one the sampler preempted on its own
+ *   CPU is back in the ready list, it is the Ready task of the highest
+ *   priority, the idle task if the CPU was idle.
+ *
+ ****************************************************************************/
+
+static void profile_sample(void)
+{
+  FAR const char *state;
+  FAR const char *prio;
+  pid_t self = getpid();
+  pid_t preempted = -1;
+  int best = -1;
+  char buf[256];
+  ssize_t n;
+  int i;
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      FAR struct profile_task_s *task = &g_profile.tasks[i];
+
+      if (task->fd < 0 || task->pid == self)
+        {
+          continue;
+        }
+
+      n = pread(task->fd, buf, sizeof(buf) - 1, 0);
+      if (n <= 0)
+        {
+          continue;
+        }
+
+      buf[n] = '\0';
+      state = profile_field(buf, "State:");
+      if (state == NULL)
+        {
+          continue;
+        }
+
+      if (strncmp(state, "Running", 7) == 0)
+        {
+          profile_record(task->pid);
+        }
+      else if (strncmp(state, "Ready", 5) == 0)
+        {
+          prio = profile_field(buf, "Priority:");
+          if (prio != NULL && atoi(prio) > best)
+            {
+              best = atoi(prio);
+              preempted = task->pid;
+            }
+        }
+    }
+
+  if (preempted >= 0)
+    {
+      profile_record(preempted);
+    }
+}
+
+/****************************************************************************
+ * Name: profile_daemon
+ ****************************************************************************/
+
+static int profile_daemon(int argc, FAR char *argv[])
+{
+  const uint64_t period = NSEC_PER_SEC / CONFIG_PYXIS_SYSMON_PROFILE_RATE;
+  struct timespec ts;
+  uint64_t next = profile_clock();
+  uint64_t now;
+  int i;
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      g_profile.tasks[i].fd = -1;
+    }
+
+  g_profile.nextscan = 0;
+
+  while (!g_profile.stop)
+    {
+      /* Absolute deadlines keep the rate exact, a late sampler skips the
+       * periods it missed instead of catching up in a burst.
+       */
+
+      next += period;
+      now = profile_clock();
+      if (next < now)
+        {
+          next = now + period;
+        }
+
+      ts.tv_sec = next / NSEC_PER_SEC;
+      ts.tv_nsec = next % NSEC_PER_SEC;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+      if (next >= g_profile.nextscan)
+        {
+          profile_scan();
+          g_profile.nextscan = next + PROFILE_SCAN * NSEC_PER_MSEC;
+        }
+
+      profile_sample();
+    }
+
+  pthread_mutex_lock(&g_profile.lock);
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      if (g_profile.tasks[i].fd >= 0)
+        {
+          close(g_profile.tasks[i].fd);
+          g_profile.tasks[i].fd = -1;
+        }
+    }
+
+  pthread_mutex_unlock(&g_profile.lock);
+
+  if (g_profile.dir != NULL)
+    {
+      closedir(g_profile.dir);
+      g_profile.dir = NULL;
+    }
+
+  g_profile.stop = false;
+  g_profile.started = false;
+  return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+ * Name: profile_func
+ *
+ * Description:
+ *   Map a code address to the function containing it.  Without the kernel
+ *   symbol table the address itself is used, to be resolved offline.
+ *
+ ****************************************************************************/
+
+static uintptr_t profile_func(uintptr_t pc, FAR const char **name)
+{
+#ifdef CONFIG_ALLSYMS
+  FAR const struct symtab_s *sym;
+  size_t size;
+
+  sym = allsyms_findbyvalue((FAR void *)pc, &size);
+  if (sym != NULL)
+    {
+      *name = sym->sym_name;
+      return (uintptr_t)sym->sym_value;
+    }
+#endif
+
+  *name = NULL;
+  return pc;
+}
+
+/****************************************************************************
+ * Name: profile_task_name
+ *
+ * Description:
+ *   Copy the name of pid to buf, taken under the lock since the sampler
+ *   reuses the slots of the tasks that went away.
+ *
+ ****************************************************************************/
+
+static FAR const char *profile_task_name(pid_t pid, FAR char *buf,
+                                         size_t size)
+{
+  int i;
+
+  snprintf(buf, size, "pid%d", pid);
+
+  pthread_mutex_lock(&g_profile.lock);
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++)
+    {
+      if (g_profile.tasks[i].fd >= 0 && g_profile.tasks[i].pid == pid &&
+          g_profile.tasks[i].name[0] != '\0')
+        {
+          strlcpy(buf, g_profile.tasks[i].name, size);
+          break;
+        }
+    }
+
+  pthread_mutex_unlock(&g_profile.lock);
+  return buf;
+}
+
+/****************************************************************************
+ * Name: profile_hot
+ *
+ * Description:
+ *   Print the tasks by sample count, each with its hottest functions.
+ *
+ ****************************************************************************/
+
+static void profile_hot(FAR struct profile_table_s *table,
+                        sysmon_profile_print_t print)
+{
+  struct profile_func_s funcs[PROFILE_NFUNCS];
+  FAR struct profile_stack_s *stack;
+  FAR const char *name;
+  unsigned long total;
+  uintptr_t addr;
+  char buf[PROFILE_NAMESIZE];
+  pid_t pid = -1;
+  int nfuncs;
+  int i;
+  int j;
+  int k;
+
+  print("%lu samples, %lu dropped\n", table->nsamples, table->ndropped);
+  print("  PID SAMPLES  SHARE TASK/FUNCTION\n");
+
+  /* Visit each task once, from the first stack that mentions it */
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_PROFILE_STACKS; i++)
+    {
+      if (table->stacks[i].count == 0)
+        {
+          continue;
+        }
+
+      pid = table->stacks[i].pid;
+      for (j = 0; j < i; j++)
+        {
+          if (table->stacks[j].count != 0 && table->stacks[j].pid == pid)
+            {
+              break;
+            }
+        }
+
+      if (j < i)
+        {
+          continue;
+        }
+
+      total = 0;
+      nfuncs = 0;
+      for (j = i; j < CONFIG_PYXIS_SYSMON_PROFILE_STACKS; j++)
+        {
+          stack = &table->stacks[j];
+          if (stack->count == 0 || stack->pid != pid)
+            {
+              continue;
+            }
+
+          total += stack->count;
+          if (stack->depth == 0)
+            {
+              continue;
+            }
+
+          addr = profile_func(stack->frames[0], &name);
+          for (k = 0; k < nfuncs; k++)
+            {
+              if (funcs[k].addr == addr)
+                {
+                  break;
+                }
+            }
+
+          if (k == nfuncs)
+            {
+              if (nfuncs == PROFILE_NFUNCS)
+                {
+                  continue;
+                }
+
+              funcs[nfuncs].addr = addr;
+              funcs[nfuncs].name = name;
+              funcs[nfuncs++].count = 0;
+            }
+
+          funcs[k].count += stack->count;
+        }
+
+      print("%5d %7lu %3lu.%lu%% %s\n", pid, total,
+            total * 100 / table->nsamples,
+            total * 1000 / table->nsamples % 10,
+            profile_task_name(pid, buf, sizeof(buf)));
+
+      /* Selection of the hottest functions, the list is short */
+
+      for (k = 0; k < CONFIG_PYXIS_SYSMON_PROFILE_NHOT && k < nfuncs; k++)
+        {
+          struct profile_func_s tmp;
+          int best = k;
+
+          for (j = k + 1; j < nfuncs; j++)
+            {
+              if (funcs[j].count > funcs[best].count)
+                {
+                  best = j;
+                }
+            }
+
+          tmp = funcs[k];
+          funcs[k] = funcs[best];
+          funcs[best] = tmp;
+
+          if (funcs[k].name != NULL)
+            {
+              print("      %7lu %3lu.%lu%%   %s\n", funcs[k].count,
+                    funcs[k].count * 100 / total,
+                    funcs[k].count * 1000 / total % 10, funcs[k].name);
+            }
+          else
+            {
+              print("      %7lu %3lu.%lu%%   0x%08lx\n", funcs[k].count,
+                    funcs[k].count * 100 / total,
+                    funcs[k].count * 1000 / total % 10,
+                    (unsigned long)funcs[k].addr);
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: profile_fold
+ *
+ * Description:
+ *   Append the stacks in the folded format of the flame graph tools, one
+ *   "task;outer;...;inner count" line each.  The tools add up repeated
+ *   lines, so appending every interval keeps a cumulative profile.  Once
+ *   the file is past PYXIS_SYSMON_PROFILE_PATH_SIZE it is moved to
+ *   "<path>.1", replacing the previous one, and a new profile starts.
+ *
+ ****************************************************************************/
+
+static void profile_fold(FAR struct profile_table_s *table)
+{
+  FAR struct profile_stack_s *stack;
+  FAR const char *name;
+  struct stat st;
+  uintptr_t addr;
+  char buf[PROFILE_NAMESIZE];
+  FILE *out;
+  int i;
+  int j;
+
+  if (stat(CONFIG_PYXIS_SYSMON_PROFILE_PATH, &st) == 0 &&
+      st.st_size >= CONFIG_PYXIS_SYSMON_PROFILE_PATH_SIZE)
+    {
+      rename(CONFIG_PYXIS_SYSMON_PROFILE_PATH,
+             CONFIG_PYXIS_SYSMON_PROFILE_PATH ".1");
+    }
+
+  out = fopen(CONFIG_PYXIS_SYSMON_PROFILE_PATH, "a");
+  if (out == NULL)
+    {
+      return;
+    }
+
+  for (i = 0; i < CONFIG_PYXIS_SYSMON_PROFILE_STACKS; i++)
+    {
+      stack = &table->stacks[i];
+      if (stack->count == 0)
+        {
+          continue;
+        }
+
+      fputs(profile_task_name(stack->pid, buf, sizeof(buf)), out);
+      for (j = stack->depth - 1; j >= 0; j--)
+        {
+          addr = profile_func(stack->frames[j], &name);
+          if (name != NULL)
+            {
+              fprintf(out, ";%s", name);
+            }
+          else
+            {
+              fprintf(out, ";0x%08lx", (unsigned long)addr);
+            }
+        }
+
+      fprintf(out, " %lu\n", (unsigned long)stack->count);
+    }
+
+  fclose(out);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_profile_start
+ ****************************************************************************/
+
+int sysmon_profile_start(void)
+{
+  int ret;
+
+  if (g_profile.started)
+    {
+      return OK;
+    }
+
+  memset(g_profile.tables, 0, sizeof(g_profile.tables));
+  g_profile.active = 0;
+  g_profile.stop = false;
+  g_profile.started = true;
+
+  ret = task_create("System Monitor Profiler",
+                    CONFIG_PYXIS_SYSMON_PROFILE_PRIORITY,
+                    CONFIG_PYXIS_SYSMON_PROFILE_STACKSIZE, profile_daemon,
+                    NULL);
+  if (ret < 0)
+    {
+      g_profile.started = false;
+      return -errno;
+    }
+
+  g_profile.pid = ret;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_profile_stop
+ ****************************************************************************/
+
+void sysmon_profile_stop(void)
+{
+  if (g_profile.started)
+    {
+      g_profile.stop = true;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_profile_emit
+ ****************************************************************************/
+
+int sysmon_profile_emit(sysmon_profile_print_t print)
+{
+  FAR struct profile_table_s *table;
+
+  if (!g_profile.started)
+    {
+      return -EAGAIN;
+    }
+
+  /* Swap the tables, the sampler carries on in the other one */
+
+  pthread_mutex_lock(&g_profile.lock);
+  table = &g_profile.tables[g_profile.active];
+  g_profile.active ^= 1;
+  pthread_mutex_unlock(&g_profile.lock);
+
+  if (table->nsamples > 0)
+    {
+      profile_hot(table, print);
+      profile_fold(table);
+    }
+
+  memset(table, 0, sizeof(*table));
+  return OK;
+}
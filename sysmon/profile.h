@@ -0,0 +1,90 @@
+/****************************************************************************
+ * apps/system/sysmon/profile.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __VELA_PYXIS_SYSMON_PROFILE_H
+#define __VELA_PYXIS_SYSMON_PROFILE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* printf() like output function of the caller */
+
+typedef CODE int (*sysmon_profile_print_t)(FAR const char *fmt, ...);
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+
+/****************************************************************************
+ * Name: sysmon_profile_start
+ *
+ * Description:
+ *   Start the sampler task.  It wakes PYXIS_SYSMON_PROFILE_RATE times per
+ *   second and records the tasks it finds running, with their backtrace
+ *   when the kernel provides one.
+ *
+ ****************************************************************************/
+
+int sysmon_profile_start(void);
+
+/****************************************************************************
+ * Name: sysmon_profile_stop
+ ****************************************************************************/
+
+void sysmon_profile_stop(void);
+
+/****************************************************************************
+ * Name: sysmon_profile_emit
+ *
+ * Description:
+ *   Take the samples gathered since the previous call, print the hottest
+ *   functions of each task with print and append the stacks in folded
+ *   format to PYXIS_SYSMON_PROFILE_PATH.  Returns -EAGAIN if the sampler
+ *   is not running.
+ *
+ ****************************************************************************/
+
+int sysmon_profile_emit(sysmon_profile_print_t print);
+
+#endif /* CONFIG_PYXIS_SYSMON_PROFILE */
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELA_PYXIS_SYSMON_PROFILE_H */
@@ -0,0 +1,953 @@
+/****************************************************************************
+ * apps/system/sysmon/remote.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_RPMSG
+#  include <netpacket/rpmsg.h>
+#else
+#  include <sys/un.h>
+#endif
+
+#include "remote.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_PYXIS_SYSMON_REMOTE_CORE
+#  define CONFIG_PYXIS_SYSMON_REMOTE_CORE "core"
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_REMOTE_WINDOW
+#  define CONFIG_PYXIS_SYSMON_REMOTE_WINDOW 1000
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_REMOTE_PRIORITY
+#  define CONFIG_PYXIS_SYSMON_REMOTE_PRIORITY 100
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_REMOTE_STACKSIZE
+#  define CONFIG_PYXIS_SYSMON_REMOTE_STACKSIZE 2048
+#endif
+
+#define REMOTE_MAGIC     0x534d /* "SM" */
+#define REMOTE_NAMESIZE  16
+#define REMOTE_MAXPEERS  4      /* Secondaries served by the primary */
+#define REMOTE_PENDING   32     /* Samples waiting for the merge */
+#define REMOTE_NSYNC     8      /* Clock exchanges kept per peer */
+#define REMOTE_PERIOD    1000   /* Clock exchange and retry period in ms */
+
+#define NSEC_PER_SEC     1000000000ull
+#define NSEC_PER_MSEC    1000000ull
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Frame types */
+
+enum
+{
+  REMOTE_HELLO = 1,             /* Secondary to primary: core name */
+  REMOTE_SAMPLE,                /* Secondary to primary: one sample */
+  REMOTE_PING,                  /* Primary to secondary: t0 */
+  REMOTE_PONG,                  /* Secondary to primary: t0, t1, t2 */
+};
+
+/* Every frame starts with this header, len is the payload size */
+
+begin_packed_struct struct remote_hdr_s
+{
+  uint16_t magic;
+  uint8_t type;
+  uint8_t len;
+} end_packed_struct;
+
+/* Clock exchange.  t0 is when the primary sent the ping, t1 and t2 when
+ * the secondary received it and sent the pong, on their own clocks.
+ */
+
+begin_packed_struct struct remote_sync_s
+{
+  uint64_t t0;
+  uint64_t t1;
+  uint64_t t2;
+} end_packed_struct;
+
+/* A secondary seen by the primary.  offset is its clock minus the clock
+ * of the primary, taken from the exchange with the shortest round trip
+ * among the last REMOTE_NSYNC, whose error is the smallest.
+ */
+
+struct remote_peer_s
+{
+  int fd;
+  bool synced;
+  char name[REMOTE_NAMESIZE];
+  uint8_t rx[64];
+  size_t rxlen;
+  int64_t offset;
+  unsigned int nsync;
+  uint64_t rtt[REMOTE_NSYNC];
+  int64_t offsets[REMOTE_NSYNC];
+};
+
+/* A sample waiting for the merge, time is on the clock of the primary.
+ * It keeps the name of its core, the slot of the peer may be reused by
+ * another secondary before the merge.
+ */
+
+struct remote_pending_s
+{
+  char name[REMOTE_NAMESIZE];
+  struct sysmon_remote_sample_s sample;
+};
+
+/* The sockets are created the same way for both transports, only the
+ * address differs.
+ */
+
+struct remote_transport_s
+{
+  CODE int (*listen)(void);
+  CODE int (*connect)(void);
+};
+
+struct remote_s
+{
+  volatile bool started;
+  volatile bool stop;
+  pid_t pid;
+  pthread_mutex_t lock;         /* Guards the socket writes and pending */
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  int listenfd;
+  struct remote_peer_s peers[REMOTE_MAXPEERS];
+  struct remote_pending_s pending[REMOTE_PENDING];
+  int npending;
+#else
+  int fd;                       /* Connection to the primary, -1 if none */
+  volatile bool torn;           /* A frame went out in part, reconnect */
+  uint8_t rx[64];
+  size_t rxlen;
+#endif
+  unsigned long drops;
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_RPMSG
+static int remote_rpmsg_listen(void);
+static int remote_rpmsg_connect(void);
+#else
+static int remote_local_listen(void);
+static int remote_local_connect(void);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_RPMSG
+static const struct remote_transport_s g_remote_transport =
+{
+  remote_rpmsg_listen,
+  remote_rpmsg_connect,
+};
+#else
+static const struct remote_transport_s g_remote_transport =
+{
+  remote_local_listen,
+  remote_local_connect,
+};
+#endif
+
+static struct remote_s g_remote =
+{
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_RPMSG
+
+/****************************************************************************
+ * Name: remote_rpmsg_socket
+ ****************************************************************************/
+
+static int remote_rpmsg_socket(FAR struct sockaddr_rpmsg *addr,
+                               FAR const char *cpu)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->rp_family = AF_RPMSG;
+  strlcpy(addr->rp_cpu, cpu, sizeof(addr->rp_cpu));
+  strlcpy(addr->rp_name, CONFIG_PYXIS_SYSMON_REMOTE_SERVICE,
+          sizeof(addr->rp_name));
+  return socket(AF_RPMSG, SOCK_STREAM, 0);
+}
+
+/****************************************************************************
+ * Name: remote_rpmsg_listen
+ ****************************************************************************/
+
+static int remote_rpmsg_listen(void)
+{
+  struct sockaddr_rpmsg addr;
+  int fd;
+
+  fd = remote_rpmsg_socket(&addr, "");
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  if (bind(fd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, REMOTE_MAXPEERS) < 0)
+    {
+      close(fd);
+      return -errno;
+    }
+
+  return fd;
+}
+
+/****************************************************************************
+ * Name: remote_rpmsg_connect
+ ****************************************************************************/
+
+static int remote_rpmsg_connect(void)
+{
+  struct sockaddr_rpmsg addr;
+  int fd;
+
+  fd = remote_rpmsg_socket(&addr, CONFIG_PYXIS_SYSMON_REMOTE_CPU);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  if (connect(fd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      close(fd);
+      return -errno;
+    }
+
+  return fd;
+}
+
+#else
+
+/****************************************************************************
+ * Name: remote_local_socket
+ ****************************************************************************/
+
+static int remote_local_socket(FAR struct sockaddr_un *addr)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_LOCAL;
+  strlcpy(addr->sun_path, CONFIG_PYXIS_SYSMON_REMOTE_PATH,
+          sizeof(addr->sun_path));
+  return socket(AF_LOCAL, SOCK_STREAM, 0);
+}
+
+/****************************************************************************
+ * Name: remote_local_listen
+ ****************************************************************************/
+
+static int remote_local_listen(void)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  fd = remote_local_socket(&addr);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  unlink(addr.sun_path);
+  if (bind(fd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, REMOTE_MAXPEERS) < 0)
+    {
+      close(fd);
+      return -errno;
+    }
+
+  return fd;
+}
+
+/****************************************************************************
+ * Name: remote_local_connect
+ ****************************************************************************/
+
+static int remote_local_connect(void)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  fd = remote_local_socket(&addr);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  if (connect(fd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      close(fd);
+      return -errno;
+    }
+
+  return fd;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_REMOTE_RPMSG */
+
+/****************************************************************************
+ * Name: remote_clock
+ ****************************************************************************/
+
+static uint64_t remote_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: remote_send
+ *
+ * Description:
+ *   Send one frame without blocking, so a stalled peer never holds up the
+ *   sampling loop.  The caller holds the lock so frames from the daemon
+ *   and the remote task never interleave on the stream.  Returns -EAGAIN
+ *   if the frame was not sent at all, and -EPIPE if only a part of it
+ *   went out: the stream is torn and the connection must be dropped.
+ *
+ ****************************************************************************/
+
+static int remote_send(int fd, uint8_t type, FAR const void *payload,
+                       size_t len)
+{
+  uint8_t frame[sizeof(struct remote_hdr_s) + 32];
+  struct remote_hdr_s hdr;
+  size_t size = sizeof(hdr) + len;
+  size_t off = 0;
+
+  if (len > sizeof(frame) - sizeof(hdr))
+    {
+      return -EINVAL;
+    }
+
+  hdr.magic = REMOTE_MAGIC;
+  hdr.type = type;
+  hdr.len = len;
+  memcpy(frame, &hdr, sizeof(hdr));
+  memcpy(frame + sizeof(hdr), payload, len);
+
+  while (off < size)
+    {
+      ssize_t n = send(fd, frame + off, size - off, MSG_DONTWAIT);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+              return off > 0 ? -EPIPE : -EAGAIN;
+            }
+
+          return -errno;
+        }
+
+      off += n;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: remote_receive
+ *
+ * Description:
+ *   Read what is available on fd into rx and pass every complete frame to
+ *   handler.  Returns a negated errno once the connection is gone.
+ *
+ ****************************************************************************/
+
+static int remote_receive(int fd, FAR uint8_t *rx, FAR size_t *rxlen,
+                          size_t size, uint64_t now,
+                          CODE void (*handler)(FAR void *arg,
+                                               uint8_t type,
+                                               FAR const uint8_t *payload,
+                                               size_t len, uint64_t now),
+                          FAR void *arg)
+{
+  struct remote_hdr_s hdr;
+  ssize_t n;
+
+  n = recv(fd, rx + *rxlen, size - *rxlen, 0);
+  if (n <= 0)
+    {
+      return n == 0 ? -ECONNRESET : -errno;
+    }
+
+  *rxlen += n;
+  while (*rxlen >= sizeof(hdr))
+    {
+      memcpy(&hdr, rx, sizeof(hdr));
+      if (hdr.magic != REMOTE_MAGIC ||
+          sizeof(hdr) + hdr.len > size)
+        {
+          return -EPROTO;
+        }
+
+      if (*rxlen < sizeof(hdr) + hdr.len)
+        {
+          break;
+        }
+
+      handler(arg, hdr.type, rx + sizeof(hdr), hdr.len, now);
+      *rxlen -= sizeof(hdr) + hdr.len;
+      memmove(rx, rx + sizeof(hdr) + hdr.len, *rxlen);
+    }
+
+  return OK;
+}
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+
+/****************************************************************************
+ * Name: remote_queue
+ *
+ * Description:
+ *   Queue a sample for the merge, the caller holds the lock.
+ *
+ ****************************************************************************/
+
+static void remote_queue(FAR const char *name,
+                         FAR const struct sysmon_remote_sample_s *sample)
+{
+  FAR struct remote_pending_s *p;
+
+  if (g_remote.npending == REMOTE_PENDING)
+    {
+      g_remote.drops++;
+      return;
+    }
+
+  p = &g_remote.pending[g_remote.npending++];
+  strlcpy(p->name, name, sizeof(p->name));
+  p->sample = *sample;
+}
+
+/****************************************************************************
+ * Name: remote_sync
+ *
+ * Description:
+ *   Account one clock exchange.  t3 is when the pong arrived.
+ *
+ ****************************************************************************/
+
+static void remote_sync(FAR struct remote_peer_s *peer,
+                        FAR const struct remote_sync_s *sync, uint64_t t3)
+{
+  unsigned int slot = peer->nsync++ % REMOTE_NSYNC;
+  unsigned int count;
+  unsigned int best = slot;
+  unsigned int i;
+
+  peer->rtt[slot] = (t3 - sync->t0) - (sync->t2 - sync->t1);
+  peer->offsets[slot] = ((int64_t)(sync->t1 - sync->t0) +
+                         (int64_t)(sync->t2 - t3)) / 2;
+
+  count = peer->nsync < REMOTE_NSYNC ? peer->nsync : REMOTE_NSYNC;
+  for (i = 0; i < count; i++)
+    {
+      if (peer->rtt[i] < peer->rtt[best])
+        {
+          best = i;
+        }
+    }
+
+  peer->offset = peer->offsets[best];
+  peer->synced = true;
+}
+
+/****************************************************************************
+ * Name: remote_primary_frame
+ ****************************************************************************/
+
+static void remote_primary_frame(FAR void *arg, uint8_t type,
+                                 FAR const uint8_t *payload, size_t len,
+                                 uint64_t now)
+{
+  FAR struct remote_peer_s *peer = arg;
+  struct sysmon_remote_sample_s sample;
+  struct remote_sync_s sync;
+
+  switch (type)
+    {
+      case REMOTE_HELLO:
+        len = len < sizeof(peer->name) - 1 ? len : sizeof(peer->name) - 1;
+        memcpy(peer->name, payload, len);
+        peer->name[len] = '\0';
+        break;
+
+      case REMOTE_PONG:
+        if (len == sizeof(sync))
+          {
+            memcpy(&sync, payload, sizeof(sync));
+            remote_sync(peer, &sync, now);
+          }
+        break;
+
+      case REMOTE_SAMPLE:
+        if (len != sizeof(sample))
+          {
+            break;
+          }
+
+        memcpy(&sample, payload, sizeof(sample));
+        pthread_mutex_lock(&g_remote.lock);
+        if (peer->synced)
+          {
+            sample.time -= peer->offset;
+            remote_queue(peer->name, &sample);
+          }
+        else
+          {
+            g_remote.drops++;
+          }
+
+        pthread_mutex_unlock(&g_remote.lock);
+        break;
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: remote_ping
+ ****************************************************************************/
+
+static int remote_ping(FAR struct remote_peer_s *peer)
+{
+  struct remote_sync_s sync;
+  int ret;
+
+  memset(&sync, 0, sizeof(sync));
+  pthread_mutex_lock(&g_remote.lock);
+  sync.t0 = remote_clock();
+  ret = remote_send(peer->fd, REMOTE_PING, &sync, sizeof(sync));
+  pthread_mutex_unlock(&g_remote.lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: remote_primary
+ *
+ * Description:
+ *   Accept the secondaries, read their frames and run a clock exchange
+ *   with each of them every REMOTE_PERIOD ms.
+ *
+ ****************************************************************************/
+
+static void remote_primary(void)
+{
+  struct pollfd fds[REMOTE_MAXPEERS + 1];
+  FAR struct remote_peer_s *peer;
+  uint64_t nextping = 0;
+  uint64_t now;
+  int nfds;
+  int fd;
+  int i;
+
+  for (i = 0; i < REMOTE_MAXPEERS; i++)
+    {
+      g_remote.peers[i].fd = -1;
+    }
+
+  while (!g_remote.stop)
+    {
+      fds[0].fd = g_remote.listenfd;
+      fds[0].events = POLLIN;
+      for (i = 0, nfds = 1; i < REMOTE_MAXPEERS; i++)
+        {
+          fds[nfds].fd = g_remote.peers[i].fd;
+          fds[nfds++].events = POLLIN;
+        }
+
+      poll(fds, nfds, REMOTE_PERIOD);
+      now = remote_clock();
+
+      if (fds[0].revents & POLLIN)
+        {
+          fd = accept(g_remote.listenfd, NULL, NULL);
+          for (i = 0, peer = NULL; fd >= 0 && i < REMOTE_MAXPEERS; i++)
+            {
+              if (g_remote.peers[i].fd < 0)
+                {
+                  peer = &g_remote.peers[i];
+                  break;
+                }
+            }
+
+          if (peer != NULL)
+            {
+              memset(peer, 0, sizeof(*peer));
+              peer->fd = fd;
+              if (remote_ping(peer) == -EPIPE)
+                {
+                  close(peer->fd);
+                  peer->fd = -1;
+                }
+            }
+          else if (fd >= 0)
+            {
+              close(fd);
+            }
+        }
+
+      for (i = 0; i < REMOTE_MAXPEERS; i++)
+        {
+          peer = &g_remote.peers[i];
+          if (peer->fd >= 0 &&
+              (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) &&
+              remote_receive(peer->fd, peer->rx, &peer->rxlen,
+                             sizeof(peer->rx), now, remote_primary_frame,
+                             peer) < 0)
+            {
+              close(peer->fd);
+              peer->fd = -1;
+            }
+        }
+
+      if (now >= nextping)
+        {
+          for (i = 0; i < REMOTE_MAXPEERS; i++)
+            {
+              if (g_remote.peers[i].fd >= 0 &&
+                  remote_ping(&g_remote.peers[i]) == -EPIPE)
+                {
+                  close(g_remote.peers[i].fd);
+                  g_remote.peers[i].fd = -1;
+                }
+            }
+
+          nextping = now + REMOTE_PERIOD * NSEC_PER_MSEC;
+        }
+    }
+
+  for (i = 0; i < REMOTE_MAXPEERS; i++)
+    {
+      if (g_remote.peers[i].fd >= 0)
+        {
+          close(g_remote.peers[i].fd);
+          g_remote.peers[i].fd = -1;
+        }
+    }
+
+  close(g_remote.listenfd);
+}
+
+#else /* CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY */
+
+/****************************************************************************
+ * Name: remote_secondary_frame
+ ****************************************************************************/
+
+static void remote_secondary_frame(FAR void *arg, uint8_t type,
+                                   FAR const uint8_t *payload, size_t len,
+                                   uint64_t now)
+{
+  struct remote_sync_s sync;
+
+  if (type == REMOTE_PING && len == sizeof(sync))
+    {
+      memcpy(&sync, payload, sizeof(sync));
+      sync.t1 = now;
+      pthread_mutex_lock(&g_remote.lock);
+      sync.t2 = remote_clock();
+      if (remote_send(g_remote.fd, REMOTE_PONG, &sync,
+                      sizeof(sync)) == -EPIPE)
+        {
+          g_remote.torn = true;
+        }
+
+      pthread_mutex_unlock(&g_remote.lock);
+    }
+}
+
+/****************************************************************************
+ * Name: remote_secondary
+ *
+ * Description:
+ *   Keep a connection to the primary and answer its clock exchanges as
+ *   soon as they arrive.
+ *
+ ****************************************************************************/
+
+static void remote_secondary(void)
+{
+  struct pollfd fds;
+  int ret;
+  int fd;
+
+  while (!g_remote.stop)
+    {
+      if (g_remote.fd < 0)
+        {
+          fd = g_remote_transport.connect();
+          if (fd < 0)
+            {
+              usleep(REMOTE_PERIOD * 1000);
+              continue;
+            }
+
+          g_remote.rxlen = 0;
+          pthread_mutex_lock(&g_remote.lock);
+          g_remote.fd = fd;
+          ret = remote_send(fd, REMOTE_HELLO, CONFIG_PYXIS_SYSMON_REMOTE_CORE,
+                            strnlen(CONFIG_PYXIS_SYSMON_REMOTE_CORE,
+                                    REMOTE_NAMESIZE - 1));
+          g_remote.torn = ret == -EPIPE;
+          pthread_mutex_unlock(&g_remote.lock);
+        }
+
+      fds.fd = g_remote.fd;
+      fds.events = POLLIN;
+      if ((poll(&fds, 1, REMOTE_PERIOD) > 0 &&
+           remote_receive(g_remote.fd, g_remote.rx, &g_remote.rxlen,
+                          sizeof(g_remote.rx), remote_clock(),
+                          remote_secondary_frame, NULL) < 0) ||
+          g_remote.torn)
+        {
+          pthread_mutex_lock(&g_remote.lock);
+          close(g_remote.fd);
+          g_remote.fd = -1;
+          g_remote.torn = false;
+          pthread_mutex_unlock(&g_remote.lock);
+        }
+    }
+
+  pthread_mutex_lock(&g_remote.lock);
+  if (g_remote.fd >= 0)
+    {
+      close(g_remote.fd);
+      g_remote.fd = -1;
+    }
+
+  pthread_mutex_unlock(&g_remote.lock);
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY */
+
+/****************************************************************************
+ * Name: remote_daemon
+ ****************************************************************************/
+
+static int remote_daemon(int argc, FAR char *argv[])
+{
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  remote_primary();
+#else
+  remote_secondary();
+#endif
+
+  g_remote.stop = false;
+  g_remote.started = false;
+  return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_remote_start
+ ****************************************************************************/
+
+int sysmon_remote_start(void)
+{
+  int ret;
+
+  if (g_remote.started)
+    {
+      return OK;
+    }
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  g_remote.listenfd = g_remote_transport.listen();
+  if (g_remote.listenfd < 0)
+    {
+      return g_remote.listenfd;
+    }
+
+  g_remote.npending = 0;
+#else
+  g_remote.fd = -1;
+#endif
+
+  g_remote.stop = false;
+  g_remote.started = true;
+
+  ret = task_create("System Monitor Remote",
+                    CONFIG_PYXIS_SYSMON_REMOTE_PRIORITY,
+                    CONFIG_PYXIS_SYSMON_REMOTE_STACKSIZE, remote_daemon,
+                    NULL);
+  if (ret < 0)
+    {
+      ret = -errno;
+      g_remote.started = false;
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+      close(g_remote.listenfd);
+#endif
+      return ret;
+    }
+
+  g_remote.pid = ret;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_remote_stop
+ ****************************************************************************/
+
+void sysmon_remote_stop(void)
+{
+  if (g_remote.started)
+    {
+      g_remote.stop = true;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_remote_submit
+ ****************************************************************************/
+
+void sysmon_remote_submit(FAR const struct sysmon_remote_sample_s *sample)
+{
+#ifndef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  int ret = -ENOTCONN;
+#endif
+
+  pthread_mutex_lock(&g_remote.lock);
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  remote_queue(CONFIG_PYXIS_SYSMON_REMOTE_CORE, sample);
+#else
+  /* A torn stream is dropped by the remote task, send nothing more */
+
+  if (g_remote.fd >= 0 && !g_remote.torn)
+    {
+      ret = remote_send(g_remote.fd, REMOTE_SAMPLE, sample,
+                        sizeof(*sample));
+      g_remote.torn = ret == -EPIPE;
+    }
+
+  if (ret < 0)
+    {
+      g_remote.drops++;
+    }
+#endif
+
+  pthread_mutex_unlock(&g_remote.lock);
+}
+
+/****************************************************************************
+ * Name: sysmon_remote_merge
+ ****************************************************************************/
+
+void sysmon_remote_merge(uint64_t now, sysmon_remote_print_t print)
+{
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  struct remote_pending_s ready[REMOTE_PENDING];
+  uint64_t limit = now - CONFIG_PYXIS_SYSMON_REMOTE_WINDOW * NSEC_PER_MSEC;
+  int nready = 0;
+  int i;
+  int j;
+
+  /* Take the samples that are old enough, in time order */
+
+  pthread_mutex_lock(&g_remote.lock);
+  for (i = 0; i < g_remote.npending; )
+    {
+      FAR struct remote_pending_s *p = &g_remote.pending[i];
+
+      if (p->sample.time > limit)
+        {
+          i++;
+          continue;
+        }
+
+      for (j = nready; j > 0 && ready[j - 1].sample.time > p->sample.time;
+           j--)
+        {
+          ready[j] = ready[j - 1];
+        }
+
+      ready[j] = *p;
+      nready++;
+
+      *p = g_remote.pending[--g_remote.npending];
+    }
+
+  pthread_mutex_unlock(&g_remote.lock);
+
+  for (i = 0; i < nready; i++)
+    {
+      print(ready[i].name, &ready[i].sample);
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: sysmon_remote_drops
+ ****************************************************************************/
+
+unsigned long sysmon_remote_drops(void)
+{
+  return g_remote.drops;
+}
@@ -0,0 +1,129 @@
+/****************************************************************************
+ * apps/system/sysmon/remote.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __VELA_PYXIS_SYSMON_REMOTE_H
+#define __VELA_PYXIS_SYSMON_REMOTE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* The compact sample a secondary core streams to the primary.  time is
+ * the monotonic clock of the sender in ns, converted to the clock of the
+ * primary once merged.  The fields that could not be sampled are -1.
+ */
+
+begin_packed_struct struct sysmon_remote_sample_s
+{
+  uint64_t time;
+  int64_t memfree;              /* Free bytes in the user heap */
+  int32_t cpuload;              /* Total CPU load in permille */
+  int32_t iobfree;              /* Free IOBs */
+  int32_t critmax;              /* Largest critmon max in us */
+} end_packed_struct;
+
+/* Called by sysmon_remote_merge() for every sample, in time order */
+
+typedef CODE void (*sysmon_remote_print_t)(FAR const char *core,
+                   FAR const struct sysmon_remote_sample_s *sample);
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+
+/****************************************************************************
+ * Name: sysmon_remote_start
+ *
+ * Description:
+ *   Start the task serving the transport.  On the primary it accepts the
+ *   secondaries, synchronizes their clocks and queues their samples.  On a
+ *   secondary it connects to the primary and answers the clock requests.
+ *
+ ****************************************************************************/
+
+int sysmon_remote_start(void);
+
+/****************************************************************************
+ * Name: sysmon_remote_stop
+ ****************************************************************************/
+
+void sysmon_remote_stop(void);
+
+/****************************************************************************
+ * Name: sysmon_remote_submit
+ *
+ * Description:
+ *   Hand over a sample of this core.  A secondary sends it to the primary,
+ *   the primary queues it for the merge.
+ *
+ ****************************************************************************/
+
+void sysmon_remote_submit(FAR const struct sysmon_remote_sample_s *sample);
+
+/****************************************************************************
+ * Name: sysmon_remote_merge
+ *
+ * Description:
+ *   Pass the queued samples that are older than the reorder window at now
+ *   to print, ordered by their time on the clock of the primary.
+ *
+ ****************************************************************************/
+
+void sysmon_remote_merge(uint64_t now, sysmon_remote_print_t print);
+
+/****************************************************************************
+ * Name: sysmon_remote_drops
+ *
+ * Description:
+ *   Return the number of samples dropped because the queue was full, the
+ *   clock of their core was not synchronized yet or, on a secondary, the
+ *   link to the primary could not take them without blocking.
+ *
+ ****************************************************************************/
+
+unsigned long sysmon_remote_drops(void);
+
+#endif /* CONFIG_PYXIS_SYSMON_REMOTE */
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELA_PYXIS_SYSMON_REMOTE_H */
@@ -0,0 +1,434 @@
+/****************************************************************************
+ * apps/system/sysmon/sink.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sink.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_PYXIS_SYSMON_SINK_BUFSIZE
+#  define CONFIG_PYXIS_SYSMON_SINK_BUFSIZE 4096
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_SINK_PRIORITY
+#  define CONFIG_PYXIS_SYSMON_SINK_PRIORITY 20
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_SINK_STACKSIZE
+#  define CONFIG_PYXIS_SYSMON_SINK_STACKSIZE 2048
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_SINK_FILE_SIZE
+#  define CONFIG_PYXIS_SYSMON_SINK_FILE_SIZE 65536
+#endif
+
+#define SINK_LINESIZE 256
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Single producer, single consumer ring buffer.  head and tail count bytes
+ * since start and are only ever advanced, the producer owns head and the
+ * writer task owns tail.
+ */
+
+struct sysmon_sink_s
+{
+  atomic_size_t head;           /* Next byte to write */
+  atomic_size_t tail;           /* Next byte to drain */
+  atomic_ulong drops;           /* Writes dropped for a full ring or cut */
+  atomic_bool waiting;          /* The writer task sleeps on sem */
+  volatile bool started;
+  volatile bool stop;
+  sem_t sem;
+  pid_t pid;
+  int fd;                       /* File or pipe sink, -1 if not open */
+  size_t size;                  /* Bytes in the current file */
+  unsigned long reported;       /* Drops already reported in the output */
+#ifdef CONFIG_PYXIS_SYSMON_SINK_SYSLOG
+  size_t linelen;
+  char line[SINK_LINESIZE];     /* Partial line for syslog */
+#endif
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct sysmon_sink_s g_sink =
+{
+  .fd = -1,
+};
+
+static char g_sink_buffer[CONFIG_PYXIS_SYSMON_SINK_BUFSIZE];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK_FILE
+
+/****************************************************************************
+ * Name: sink_rotate
+ *
+ * Description:
+ *   Keep the current file as <path>.1 and start a new one.
+ *
+ ****************************************************************************/
+
+static void sink_rotate(void)
+{
+  if (g_sink.fd >= 0)
+    {
+      close(g_sink.fd);
+      unlink(CONFIG_PYXIS_SYSMON_SINK_PATH ".1");
+      rename(CONFIG_PYXIS_SYSMON_SINK_PATH,
+             CONFIG_PYXIS_SYSMON_SINK_PATH ".1");
+    }
+
+  g_sink.fd = open(CONFIG_PYXIS_SYSMON_SINK_PATH,
+                   O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  g_sink.size = 0;
+}
+
+#endif
+
+/****************************************************************************
+ * Name: sink_output
+ *
+ * Description:
+ *   Hand one drained chunk to the configured sink.  This runs in the writer
+ *   task and is the only place allowed to block on I/O.
+ *
+ ****************************************************************************/
+
+static void sink_output(FAR const char *buf, size_t len)
+{
+#if defined(CONFIG_PYXIS_SYSMON_SINK_CONSOLE)
+  while (len > 0)
+    {
+      ssize_t n = write(STDOUT_FILENO, buf, len);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          break;
+        }
+
+      buf += n;
+      len -= n;
+    }
+
+#elif defined(CONFIG_PYXIS_SYSMON_SINK_SYSLOG)
+  /* syslog takes whole messages, so assemble the lines first */
+
+  while (len-- > 0)
+    {
+      char ch = *buf++;
+
+      if (ch == '\n' || g_sink.linelen == sizeof(g_sink.line) - 1)
+        {
+          g_sink.line[g_sink.linelen] = '\0';
+          syslog(LOG_INFO, "%s\n", g_sink.line);
+          g_sink.linelen = 0;
+          if (ch == '\n')
+            {
+              continue;
+            }
+        }
+
+      g_sink.line[g_sink.linelen++] = ch;
+    }
+
+#elif defined(CONFIG_PYXIS_SYSMON_SINK_FILE)
+  if (g_sink.fd < 0 ||
+      g_sink.size + len > CONFIG_PYXIS_SYSMON_SINK_FILE_SIZE)
+    {
+      sink_rotate();
+    }
+
+  if (g_sink.fd >= 0 && write(g_sink.fd, buf, len) > 0)
+    {
+      g_sink.size += len;
+    }
+
+#elif defined(CONFIG_PYXIS_SYSMON_SINK_PIPE)
+  /* Nobody listening is not an error, the output is simply discarded
+   * until a reader opens the pipe.
+   */
+
+  if (g_sink.fd < 0)
+    {
+      g_sink.fd = open(CONFIG_PYXIS_SYSMON_SINK_PATH,
+                       O_WRONLY | O_NONBLOCK);
+      if (g_sink.fd < 0)
+        {
+          return;
+        }
+    }
+
+  if (write(g_sink.fd, buf, len) < 0 && errno != EAGAIN)
+    {
+      close(g_sink.fd);
+      g_sink.fd = -1;
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: sink_drain
+ ****************************************************************************/
+
+static void sink_drain(void)
+{
+  unsigned long drops = atomic_load(&g_sink.drops);
+  size_t head = atomic_load_explicit(&g_sink.head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&g_sink.tail, memory_order_relaxed);
+  char msg[64];
+
+  while (tail != head)
+    {
+      size_t off = tail % CONFIG_PYXIS_SYSMON_SINK_BUFSIZE;
+      size_t len = head - tail;
+
+      if (len > CONFIG_PYXIS_SYSMON_SINK_BUFSIZE - off)
+        {
+          len = CONFIG_PYXIS_SYSMON_SINK_BUFSIZE - off;
+        }
+
+      sink_output(&g_sink_buffer[off], len);
+      tail += len;
+      atomic_store_explicit(&g_sink.tail, tail, memory_order_release);
+    }
+
+  /* Make the loss visible in the stream itself */
+
+  if (drops != g_sink.reported)
+    {
+      snprintf(msg, sizeof(msg), "[sysmon: %lu writes dropped or cut]\n",
+               drops - g_sink.reported);
+      sink_output(msg, strlen(msg));
+      g_sink.reported = drops;
+    }
+}
+
+/****************************************************************************
+ * Name: sink_daemon
+ ****************************************************************************/
+
+static int sink_daemon(int argc, FAR char *argv[])
+{
+  while (!g_sink.stop)
+    {
+      /* Announce the sleep before the last emptiness check so a write
+       * racing with it always posts the semaphore.
+       */
+
+      atomic_store(&g_sink.waiting, true);
+      if (atomic_load(&g_sink.head) == atomic_load(&g_sink.tail) &&
+          atomic_load(&g_sink.drops) == g_sink.reported)
+        {
+          sem_wait(&g_sink.sem);
+        }
+
+      atomic_store(&g_sink.waiting, false);
+      sink_drain();
+    }
+
+  sink_drain();
+
+#if defined(CONFIG_PYXIS_SYSMON_SINK_FILE) || \
+    defined(CONFIG_PYXIS_SYSMON_SINK_PIPE)
+  if (g_sink.fd >= 0)
+    {
+      close(g_sink.fd);
+      g_sink.fd = -1;
+    }
+#endif
+
+  g_sink.stop = false;
+  g_sink.started = false;
+  return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_sink_start
+ ****************************************************************************/
+
+int sysmon_sink_start(void)
+{
+  int ret;
+
+  if (g_sink.started)
+    {
+      return OK;
+    }
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK_PIPE
+  if (mkfifo(CONFIG_PYXIS_SYSMON_SINK_PATH, 0666) < 0 && errno != EEXIST)
+    {
+      return -errno;
+    }
+#endif
+
+  sem_init(&g_sink.sem, 0, 0);
+  g_sink.stop = false;
+  g_sink.started = true;
+
+  ret = task_create("System Monitor Sink", CONFIG_PYXIS_SYSMON_SINK_PRIORITY,
+                    CONFIG_PYXIS_SYSMON_SINK_STACKSIZE, sink_daemon, NULL);
+  if (ret < 0)
+    {
+      g_sink.started = false;
+      sem_destroy(&g_sink.sem);
+      return -errno;
+    }
+
+  g_sink.pid = ret;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_sink_stop
+ ****************************************************************************/
+
+void sysmon_sink_stop(void)
+{
+  if (g_sink.started)
+    {
+      g_sink.stop = true;
+      sem_post(&g_sink.sem);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_sink_write
+ ****************************************************************************/
+
+size_t sysmon_sink_write(FAR const char *buf, size_t len)
+{
+  size_t head;
+  size_t tail;
+  size_t off;
+  size_t n;
+
+  if (!g_sink.started)
+    {
+      return fwrite(buf, 1, len, stdout);
+    }
+
+  head = atomic_load_explicit(&g_sink.head, memory_order_relaxed);
+  tail = atomic_load_explicit(&g_sink.tail, memory_order_acquire);
+
+  /* Drop the newest data rather than tearing what is already queued */
+
+  if (len > CONFIG_PYXIS_SYSMON_SINK_BUFSIZE - (head - tail))
+    {
+      atomic_fetch_add(&g_sink.drops, 1);
+      len = 0;
+    }
+  else
+    {
+      off = head % CONFIG_PYXIS_SYSMON_SINK_BUFSIZE;
+      n = CONFIG_PYXIS_SYSMON_SINK_BUFSIZE - off;
+      if (n > len)
+        {
+          n = len;
+        }
+
+      memcpy(&g_sink_buffer[off], buf, n);
+      memcpy(g_sink_buffer, buf + n, len - n);
+      atomic_store_explicit(&g_sink.head, head + len, memory_order_release);
+    }
+
+  if (atomic_exchange(&g_sink.waiting, false))
+    {
+      sem_post(&g_sink.sem);
+    }
+
+  return len;
+}
+
+/****************************************************************************
+ * Name: sysmon_sink_vprintf
+ ****************************************************************************/
+
+int sysmon_sink_vprintf(FAR const char *fmt, va_list ap)
+{
+  char line[SINK_LINESIZE];
+  int ret;
+
+  if (!g_sink.started)
+    {
+      return vprintf(fmt, ap);
+    }
+
+  ret = vsnprintf(line, sizeof(line), fmt, ap);
+  if (ret >= (int)sizeof(line))
+    {
+      /* Keep what fits, the cut is counted like a drop */
+
+      atomic_fetch_add(&g_sink.drops, 1);
+      sysmon_sink_write(line, sizeof(line) - 1);
+    }
+  else if (ret > 0)
+    {
+      sysmon_sink_write(line, ret);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_sink_drops
+ ****************************************************************************/
+
+unsigned long sysmon_sink_drops(void)
+{
+  return atomic_load(&g_sink.drops);
+}
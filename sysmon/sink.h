@@ -0,0 +1,109 @@
+/****************************************************************************
+ * apps/system/sysmon/sink.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __VELA_PYXIS_SYSMON_SINK_H
+#define __VELA_PYXIS_SYSMON_SINK_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+
+/****************************************************************************
+ * Name: sysmon_sink_start
+ *
+ * Description:
+ *   Open the configured sink and start the writer task draining the ring
+ *   buffer.  Until it is started the output goes straight to stdout.
+ *
+ ****************************************************************************/
+
+int sysmon_sink_start(void);
+
+/****************************************************************************
+ * Name: sysmon_sink_stop
+ *
+ * Description:
+ *   Ask the writer task to drain the ring buffer and exit.
+ *
+ ****************************************************************************/
+
+void sysmon_sink_stop(void);
+
+/****************************************************************************
+ * Name: sysmon_sink_write
+ *
+ * Description:
+ *   Queue len bytes for the writer task without ever blocking.  A write
+ *   that does not fit in the free space is dropped as a whole and counted.
+ *   Returns len, or 0 if the write was dropped.
+ *
+ ****************************************************************************/
+
+size_t sysmon_sink_write(FAR const char *buf, size_t len);
+
+/****************************************************************************
+ * Name: sysmon_sink_vprintf
+ *
+ * Description:
+ *   Format into a line buffer on the stack and queue it with
+ *   sysmon_sink_write().  Output longer than the buffer is cut and counted
+ *   as a drop.  Returns the number of formatted bytes like vprintf().
+ *
+ ****************************************************************************/
+
+int sysmon_sink_vprintf(FAR const char *fmt, va_list ap);
+
+/****************************************************************************
+ * Name: sysmon_sink_drops
+ *
+ * Description:
+ *   Return the number of writes dropped or cut since start.
+ *
+ ****************************************************************************/
+
+unsigned long sysmon_sink_drops(void);
+
+#endif /* CONFIG_PYXIS_SYSMON_SINK */
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELA_PYXIS_SYSMON_SINK_H */
@@ -0,0 +1,180 @@
+/****************************************************************************
+ * apps/system/sysmon/snapshot.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __VELA_PYXIS_SYSMON_SNAPSHOT_H
+#define __VELA_PYXIS_SYSMON_SNAPSHOT_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The shared memory object the daemon publishes its latest sample in */
+
+#define SYSMON_SNAPSHOT_NAME     "/sysmon"
+#define SYSMON_SNAPSHOT_MAGIC    0x534d4f4e /* "SMON" */
+#define SYSMON_SNAPSHOT_VERSION  1
+
+#define SYSMON_SNAPSHOT_NTOP     8          /* Busiest tasks listed */
+#define SYSMON_SNAPSHOT_NAMESIZE 16
+
+/* flags */
+
+#define SYSMON_SNAPSHOT_RUNNING  (1 << 0)   /* The daemon updates it */
+
+/* A read gives up after this many attempts overlapping an update */
+
+#define SYSMON_SNAPSHOT_RETRIES  4
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One of the busiest tasks, load is in permille of one CPU */
+
+struct sysmon_snapshot_task_s
+{
+  int32_t pid;
+  int32_t load;
+  char name[SYSMON_SNAPSHOT_NAMESIZE];
+};
+
+/* The fixed layout of the snapshot.  seq is odd while the daemon writes
+ * it.  The fields that could not be sampled are -1.
+ */
+
+struct sysmon_snapshot_s
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;                /* sizeof(struct sysmon_snapshot_s) */
+  uint32_t seq;
+  uint32_t flags;
+  uint64_t time;                /* CLOCK_MONOTONIC of the sample in ns */
+  int32_t cpuload;              /* Total CPU load in permille */
+  int32_t iobfree;              /* Free IOBs */
+  int64_t memtotal;             /* User heap size in bytes */
+  int64_t memfree;              /* Free bytes in the user heap */
+  int64_t memlargest;           /* Largest free chunk of the user heap */
+  uint32_t ntop;                /* Valid entries in top */
+  uint32_t reserved;
+  struct sysmon_snapshot_task_s top[SYSMON_SNAPSHOT_NTOP];
+};
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_snapshot_map
+ *
+ * Description:
+ *   Map the snapshot read only.  This takes a few system calls, do it once
+ *   and keep the mapping.  Returns NULL if the daemon never published one.
+ *
+ ****************************************************************************/
+
+static inline FAR const struct sysmon_snapshot_s *sysmon_snapshot_map(void)
+{
+  FAR void *addr;
+  int fd;
+
+  fd = shm_open(SYSMON_SNAPSHOT_NAME, O_RDONLY, 0);
+  if (fd < 0)
+    {
+      return NULL;
+    }
+
+  addr = mmap(NULL, sizeof(struct sysmon_snapshot_s), PROT_READ,
+              MAP_SHARED, fd, 0);
+  close(fd);
+  return addr != MAP_FAILED ? addr : NULL;
+}
+
+/****************************************************************************
+ * Name: sysmon_snapshot_read
+ *
+ * Description:
+ *   Copy a consistent snapshot out of the mapping.  This never blocks nor
+ *   enters the kernel: an attempt that overlaps an update of the daemon is
+ *   retried up to SYSMON_SNAPSHOT_RETRIES times, then false is returned.
+ *   Also false if the layout does not match this header.
+ *
+ ****************************************************************************/
+
+static inline bool
+sysmon_snapshot_read(FAR const struct sysmon_snapshot_s *shm,
+                     FAR struct sysmon_snapshot_s *snap)
+{
+  uint32_t seq;
+  int i;
+
+  if (shm->magic != SYSMON_SNAPSHOT_MAGIC ||
+      shm->version != SYSMON_SNAPSHOT_VERSION ||
+      shm->size != sizeof(*shm))
+    {
+      return false;
+    }
+
+  for (i = 0; i < SYSMON_SNAPSHOT_RETRIES; i++)
+    {
+      seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+      if (seq & 1)
+        {
+          continue;
+        }
+
+      memcpy(snap, shm, sizeof(*snap));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq)
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELA_PYXIS_SYSMON_SNAPSHOT_H */
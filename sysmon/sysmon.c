@@ -24,16 +24,28 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <malloc.h>
 #include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 #include <nuttx/note/notectl_driver.h>
 
+#include "bench.h"
+#include "profile.h"
+#include "remote.h"
+#include "sink.h"
+#include "snapshot.h"
 #include "trace.h"
 
 #ifdef CONFIG_PYXIS_SYSMON
@@ -58,8 +70,226 @@
 #define CONFIG_PYXIS_SYSMON_MOUNTPOINT "/proc"
 #endif
 
+#ifndef CONFIG_PYXIS_SYSMON_MAX_TASKS
+#define CONFIG_PYXIS_SYSMON_MAX_TASKS 32
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_BENCH_PATH
+#define CONFIG_PYXIS_SYSMON_BENCH_PATH "/tmp/sysmon"
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TOPLOAD_NTASKS
+#define CONFIG_PYXIS_SYSMON_TOPLOAD_NTASKS 8
+#endif
+
+#ifdef CONFIG_SMP
+#define NCPUS CONFIG_SMP_NCPUS
+#else
+#define NCPUS 1
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_BURST_INTERVAL
+#define CONFIG_PYXIS_SYSMON_BURST_INTERVAL 100
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_BURST_HOLD
+#define CONFIG_PYXIS_SYSMON_BURST_HOLD 20
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRIGGER_CPULOAD
+#define CONFIG_PYXIS_SYSMON_TRIGGER_CPULOAD 80
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRIGGER_MEMFREE
+#define CONFIG_PYXIS_SYSMON_TRIGGER_MEMFREE 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRIGGER_IOBFREE
+#define CONFIG_PYXIS_SYSMON_TRIGGER_IOBFREE 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRIGGER_CRITMON
+#define CONFIG_PYXIS_SYSMON_TRIGGER_CRITMON 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_PATH
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_PATH "/data/sysmon"
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES 32
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_MAX
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_MAX 8
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_RETAIN
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_RETAIN 4
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_CPULOAD
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_CPULOAD 90
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_FLIGHTREC_CRITMON
+#define CONFIG_PYXIS_SYSMON_FLIGHTREC_CRITMON 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_MEMINFO_HEAPS
+#define CONFIG_PYXIS_SYSMON_MEMINFO_HEAPS 4
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY
+#define CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY 16
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_MEMINFO_LEAK_SLOPE
+#define CONFIG_PYXIS_SYSMON_MEMINFO_LEAK_SLOPE 16
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_STACK_THRESHOLD
+#define CONFIG_PYXIS_SYSMON_STACK_THRESHOLD 80
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_CRITDIST_BUDGET
+#define CONFIG_PYXIS_SYSMON_CRITDIST_BUDGET 1000
+#endif
+
+/* Decades of the interval maxima histogram: <10us up to >=10ms */
+
+#define SYSMON_CRIT_BUCKETS 5
+
+#ifndef CONFIG_PYXIS_SYSMON_IOB_WATERMARK
+#define CONFIG_PYXIS_SYSMON_IOB_WATERMARK 4
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_IRQS_MAX
+#define CONFIG_PYXIS_SYSMON_IRQS_MAX 32
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_IRQS_NTOP
+#define CONFIG_PYXIS_SYSMON_IRQS_NTOP 8
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_IRQS_STORM_FACTOR
+#define CONFIG_PYXIS_SYSMON_IRQS_STORM_FACTOR 4
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_IRQS_STORM_MIN
+#define CONFIG_PYXIS_SYSMON_IRQS_STORM_MIN 100
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_DELTA_KEYFRAME
+#define CONFIG_PYXIS_SYSMON_DELTA_KEYFRAME 10
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_DELTA_EPSILON
+#define CONFIG_PYXIS_SYSMON_DELTA_EPSILON 5
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_DELTA_LINES
+#define CONFIG_PYXIS_SYSMON_DELTA_LINES 16
+#endif
+
+/* Numbers of a line compared one by one by the delta filter */
+
+#define SYSMON_DELTA_NUMS 6
+
+#ifndef CONFIG_PYXIS_SYSMON_BUDGET
+#define CONFIG_PYXIS_SYSMON_BUDGET 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_PS
+#define CONFIG_PYXIS_SYSMON_PERIOD_PS 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_CRITMON
+#define CONFIG_PYXIS_SYSMON_PERIOD_CRITMON 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_TRACE
+#define CONFIG_PYXIS_SYSMON_PERIOD_TRACE 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_STACK
+#define CONFIG_PYXIS_SYSMON_PERIOD_STACK 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_PROFILE
+#define CONFIG_PYXIS_SYSMON_PERIOD_PROFILE 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_IRQS
+#define CONFIG_PYXIS_SYSMON_PERIOD_IRQS 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_CPULOAD
+#define CONFIG_PYXIS_SYSMON_PERIOD_CPULOAD 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_MEMINFO
+#define CONFIG_PYXIS_SYSMON_PERIOD_MEMINFO 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_IOBINFO
+#define CONFIG_PYXIS_SYSMON_PERIOD_IOBINFO 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_TOPLOAD
+#define CONFIG_PYXIS_SYSMON_PERIOD_TOPLOAD 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_PERIOD_SELFSTAT
+#define CONFIG_PYXIS_SYSMON_PERIOD_SELFSTAT 0
+#endif
+
+/* The cheap metric probe runs on every tick when any feature needs it */
+
+#if defined(CONFIG_PYXIS_SYSMON_ADAPTIVE) || \
+    defined(CONFIG_PYXIS_SYSMON_FLIGHTREC) || \
+    defined(CONFIG_PYXIS_SYSMON_REMOTE)
+#define SYSMON_HAVE_PROBE
+#endif
+
 #define MAX_CPULOAD_HISTORY 57
 
+#define NSEC_PER_SEC 1000000000ull
+#define NSEC_PER_MSEC 1000000ull
+
+/* The interval in ms, it can be changed at run time with sysmon_ctl */
+
+#define SYSMON_IDLE_PERIOD (g_sysmon.interval)
+
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+#define sysmon_stat_begin(c) sysmon_selfstat_begin(c)
+#define sysmon_stat_end(c)   sysmon_selfstat_end(c)
+#else
+#define sysmon_stat_begin(c)
+#define sysmon_stat_end(c)
+#endif
+
+/* A collector period of 0 in Kconfig means the global interval */
+
+#define SYSMON_PERIOD(c) ((c)->period > 0 ? (c)->period : SYSMON_IDLE_PERIOD)
+
+/* Collectors failing this many passes in a row are disabled */
+
+#define SYSMON_MAX_ERRORS 10
+
+/* Budget overruns stretch the period of a collector up to this factor */
+
+#define SYSMON_MAX_STRETCH 8
+
+/* Node paths are built in buffers of this size, "/<pid>/critmon" has to
+ * fit behind the root of the tree
+ */
+
+#define SYSMON_PATH_SIZE 64
+#define SYSMON_ROOT_MAX  (SYSMON_PATH_SIZE - 16)
+
+#define nitems(a) (sizeof(a) / sizeof((a)[0]))
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -67,602 +297,3602 @@
 struct sysmon_state_s {
   volatile bool started;
   volatile bool stop;
+  volatile bool samplenow;  /* Run every collector at the next wakeup */
+  volatile unsigned int newinterval; /* Interval to apply, 0 if none */
+  unsigned int interval;    /* Current interval in ms */
+  sem_t wake;               /* Posted to wake the daemon up early */
   pid_t pid;
   char line[80];
+  size_t nbytes;            /* Bytes of sampling output emitted */
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  unsigned int npasses;     /* Collector passes run */
+  unsigned int nsteady;     /* Later passes that left the heap grown */
+  long steadybytes;         /* Heap growth over those passes */
+#endif
+  FAR const char* root;     /* Top of the procfs tree */
+  DIR* procdir;             /* Kept open, rewound for every task walk */
+  uint64_t now;             /* Start of the current collector pass */
+#ifdef CONFIG_PYXIS_SYSMON_ADAPTIVE
+  unsigned int period;      /* Current sampling period in ms */
+  unsigned int calm;        /* Burst samples since the last trip */
+#endif
+};
+
+/* The cheap metrics probed on every tick of the daemon.  Fields that could
+ * not be read are left at -1.
+ */
+
+struct sysmon_sample_s {
+  uint64_t time;            /* Monotonic time stamp in ns */
+  int cpuload;              /* Total CPU load in tenths of a percent */
+  long memfree;             /* Free bytes in the user heap */
+  int iobfree;              /* Number of free IOBs */
+  long critmax;             /* Largest critmon max over all CPUs in us */
+};
+
+/* The flight recorder keeps the last samples in a ring and freezes them
+ * together with the trace buffer and the task table when a trigger fires.
+ */
+
+struct sysmon_flight_s {
+  struct sysmon_sample_s history[CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES];
+  unsigned int head;        /* Next slot to write in history */
+  unsigned int nsamples;    /* Valid samples in history */
+  unsigned int nsnaps;      /* Snapshots taken since boot */
+  bool armed;               /* Previous sample did not trip */
+  FILE* out;                /* Snapshot being written */
+};
+
+struct sysmon_feature_s {
+  FAR const char* d_name;
+  FAR char* path;
+  bool enabled;
+};
+
+/* A collector descriptor.  init runs once when the monitor starts and may
+ * refuse the collector by returning a negated errno.  On every pass sample
+ * gathers the data and emit prints it, either may be NULL.  A negated errno
+ * from sample skips emit for that pass.  The scheduler in the daemon runs a
+ * collector only when its period has elapsed.
+ */
+
+struct sysmon_collector_s {
+  FAR const char* name;
+  FAR const char* node;     /* procfs node required by the collector */
+  FAR const char* title;    /* Header printed before emit, or NULL */
+  CODE int (*init)(FAR struct sysmon_collector_s* c);
+  CODE int (*sample)(FAR struct sysmon_collector_s* c);
+  CODE int (*emit)(FAR struct sysmon_collector_s* c);
+  unsigned int period;      /* Period in ms, 0 follows the interval */
+  unsigned int budget;      /* Cost budget of one pass in us, 0 for none */
+  bool enabled;
+  FAR char* path;           /* Full path of node */
+  unsigned int stretch;     /* Period multiplier after budget overruns */
+  unsigned int overruns;    /* Passes over budget since start */
+  unsigned int nerrors;     /* Failed passes in a row */
+  uint64_t due;             /* Monotonic time of the next pass in ns */
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  uint64_t start;           /* Begin of the running pass */
+  size_t startbytes;        /* Output counter at the begin of the pass */
+  int startheap;            /* Heap in use at the begin of the pass */
+  uint64_t time;            /* Time spent since the last report in ns */
+  size_t nbytes;            /* Bytes emitted since the last report */
+  long heap;                /* Heap growth since the last report */
+  unsigned int npasses;     /* Passes since the last report */
+#endif
 };
 
-struct sysmon_feature_s {
-  FAR const char* d_name;
-  FAR char* path;
-  bool enabled;
-};
+/* Buffered line reader over a plain file descriptor.  It lives on the
+ * stack so reading a procfs node never allocates a FILE.
+ */
+
+struct sysmon_file_s {
+  int fd;
+  size_t pos;
+  size_t len;
+  char buf[128];
+};
+
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+/* What was last emitted on one output line of a collector: the hash of
+ * its text without the numbers, and the first numbers themselves.
+ */
+
+struct sysmon_delta_s {
+  uint32_t hash;
+  uint8_t nnums;
+  float nums[SYSMON_DELTA_NUMS];
+};
+
+/* Line filter state of the differential mode */
+
+struct sysmon_deltastate_s {
+  bool active;              /* Filtering the lines of a pass */
+  bool keyframe;            /* Emit every line of this pass */
+  int collector;            /* Running collector, -1 before the first */
+  unsigned int nlines;      /* Lines emitted by the running collector */
+  unsigned int npasses;
+  size_t len;
+  char line[128];           /* Line being assembled */
+  size_t npending;
+  size_t npasspending;      /* Part of pending that is the pass header */
+  char pending[256];        /* Unchanged headings held back */
+};
+#endif
+
+/* Per-task bookkeeping kept between two samples.  Slots with pid < 0 are
+ * free.  load is expressed in tenths of a percent.
+ */
+
+struct sysmon_task_s {
+  pid_t pid;
+  bool seen;
+  bool has_runtime;
+  uint64_t runtime;
+  int load;
+#if CONFIG_TASK_NAME_SIZE > 0
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+#endif
+};
+
+/* Stack usage of one task as reported by <pid>/stack.  used is the high
+ * water mark, or 0 when the kernel does not track it.
+ */
+
+struct sysmon_stack_s {
+  pid_t pid;
+  bool seen;
+  size_t size;
+  size_t used;
+#if CONFIG_TASK_NAME_SIZE > 0
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+#endif
+};
+
+/* Distribution of the critmon maxima of one task or CPU.  The maxima are
+ * reset after every read, so preemp and csection are the maxima of the last
+ * interval in us and hist counts the intervals by the larger of the two.
+ * maxpreemp and maxcsection keep the running maxima in ns for the views
+ * that used to show the kernel's lifetime values.
+ */
+
+struct sysmon_crit_s {
+  pid_t pid;
+  bool seen;
+  bool primed;              /* First read done, it covers the time since boot */
+  uint32_t preemp;
+  uint32_t csection;
+  uint32_t lifetime;        /* Previous maximum, when the reset is missing */
+  uint64_t maxpreemp;
+  uint64_t maxcsection;
+  unsigned long nintervals;
+  unsigned long nover;      /* Intervals above the budget */
+  unsigned long hist[SYSMON_CRIT_BUCKETS];
+#if CONFIG_TASK_NAME_SIZE > 0
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+#endif
+};
+
+/* Per-IRQ counters of /proc/irqs.  rate is in interrupts per second and
+ * average is its moving average, in 1/16 interrupts per second.  time is
+ * the handler time column when the kernel reports one, -1 otherwise.
+ */
+
+struct sysmon_irq_s {
+  int irq;
+  bool seen;
+  bool storm;
+  unsigned long count;
+  unsigned long delta;
+  unsigned long rate;
+  unsigned long average;
+  long time;
+};
+
+/* Counters of /proc/iobinfo */
+
+struct sysmon_iob_s {
+  int ntotal;
+  int nfree;
+  int nwait;
+  int nthrottle;
+};
+
+/* Numeric view of one heap line of /proc/meminfo and its recent history.
+ * fragmentation is the ratio of the largest free chunk to the total free
+ * memory, in permille, so 1000 means no fragmentation at all.
+ */
+
+struct sysmon_heap_s {
+  char name[16];
+  bool seen;
+  long total;
+  long used;
+  long free;
+  long largest;             /* Largest free chunk, -1 if not reported */
+  int nfree;                /* Free chunk count, -1 if not reported */
+  unsigned int head;        /* Next slot to write in the history */
+  unsigned int nsamples;    /* Valid samples in the history */
+  long usedhist[CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY];
+  int fraghist[CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#ifndef CONFIG_NSH_DISABLE_PS
+static int sysmon_ps_emit(FAR struct sysmon_collector_s* c);
+#endif
+static int sysmon_critmon_emit(FAR struct sysmon_collector_s* c);
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+static int sysmon_stack_directory(FAR struct dirent* entryp);
+static int sysmon_stack_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_stack_emit(FAR struct sysmon_collector_s* c);
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+static FAR struct sysmon_crit_s* sysmon_crit_get(pid_t pid);
+static void sysmon_crit_record(FAR struct sysmon_crit_s* crit,
+                               FAR const char* maxpreemp,
+                               FAR const char* maxcrit);
+static void sysmon_crit_reset(FAR const char* path);
+static FAR const char* sysmon_crit_format(FAR char* buffer, size_t size,
+                                          FAR const char* value,
+                                          uint64_t max);
+#endif
+#ifdef CONFIG_DRIVERS_NOTERAM
+static int sysmon_trace_emit(FAR struct sysmon_collector_s* c);
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+static int sysmon_profile_collect(FAR struct sysmon_collector_s* c);
+#endif
+static int sysmon_cpuload_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_cpuload_emit(FAR struct sysmon_collector_s* c);
+static int sysmon_cat_emit(FAR struct sysmon_collector_s* c);
+static int sysmon_irqs_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_irqs_emit(FAR struct sysmon_collector_s* c);
+static int sysmon_meminfo_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_meminfo_emit(FAR struct sysmon_collector_s* c);
+static int sysmon_iob_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_iob_emit(FAR struct sysmon_collector_s* c);
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+static int sysmon_topload_sample(FAR struct sysmon_collector_s* c);
+static int sysmon_topload_emit(FAR struct sysmon_collector_s* c);
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+static int sysmon_selfstat_emit(FAR struct sysmon_collector_s* c);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct sysmon_state_s g_sysmon = {
+  .interval = CONFIG_PYXIS_SYSMON_INTERVAL * 1000,
+  .root = CONFIG_PYXIS_SYSMON_MOUNTPOINT,
+};
+/* The collector registry, in output order */
+
+static struct sysmon_collector_s g_collectors[] = {
+#ifndef CONFIG_NSH_DISABLE_PS
+  {
+    .name = "ps",
+    .emit = sysmon_ps_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_PS,
+  },
+#endif
+  {
+    .name = "critmon",
+    .node = "critmon",
+    .emit = sysmon_critmon_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_CRITMON,
+  },
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+  {
+    .name = "stack",
+    .node = "self/stack",
+    .title = "Stack usage:\n",
+    .sample = sysmon_stack_sample,
+    .emit = sysmon_stack_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_STACK,
+  },
+#endif
+#ifdef CONFIG_DRIVERS_NOTERAM
+  {
+    .name = "trace",
+    .title = "Processes switch info:\n"
+             "[CPU] Time:   Prev_task-PID State ==> Next_task-PID\n",
+    .emit = sysmon_trace_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_TRACE,
+  },
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+  {
+    .name = "profile",
+    .title = "Profile hot functions:\n",
+    .emit = sysmon_profile_collect,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_PROFILE,
+  },
+#endif
+  {
+    .name = "irqs",
+    .node = "irqs",
+    .title = "Interrupt info:\n",
+    .sample = sysmon_irqs_sample,
+    .emit = sysmon_irqs_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_IRQS,
+  },
+  {
+    .name = "cpuload",
+    .node = "cpuload",
+    .sample = sysmon_cpuload_sample,
+    .emit = sysmon_cpuload_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_CPULOAD,
+  },
+  {
+    .name = "meminfo",
+    .node = "meminfo",
+    .title = "Memory usage:\n",
+    .sample = sysmon_meminfo_sample,
+    .emit = sysmon_meminfo_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_MEMINFO,
+  },
+  {
+    .name = "iobinfo",
+    .node = "iobinfo",
+    .title = "IO block usage:\n",
+    .sample = sysmon_iob_sample,
+    .emit = sysmon_iob_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_IOBINFO,
+  },
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+  {
+    .name = "topload",
+    .node = "self/loadavg",
+    .sample = sysmon_topload_sample,
+    .emit = sysmon_topload_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_TOPLOAD,
+  },
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  {
+    .name = "self",
+    .title = "Self metrics:\n",
+    .emit = sysmon_selfstat_emit,
+    .period = CONFIG_PYXIS_SYSMON_PERIOD_SELFSTAT,
+  },
+#endif
+};
+
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+static struct sysmon_delta_s
+  g_deltas[nitems(g_collectors)][CONFIG_PYXIS_SYSMON_DELTA_LINES];
+static struct sysmon_deltastate_s g_delta;
+#endif
+
+static struct sysmon_feature_s notectl = {
+  .d_name = "/dev/notectl", .path = NULL, .enabled = false
+};
+static int notectlfd = 0;
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+static uint64_t g_selfstart;
+static uint64_t g_selfbusy;
+#endif
+#if CONFIG_TASK_NAME_SIZE > 0
+static const char g_name[] = "Name:";
+#endif
+
+static int clhistory[MAX_CPULOAD_HISTORY];
+static int clfraction;
+
+static struct sysmon_irq_s g_irqs[CONFIG_PYXIS_SYSMON_IRQS_MAX];
+static int g_nirqs;
+static uint64_t g_irqstime;
+
+static struct sysmon_iob_s g_iob;
+static struct sysmon_iob_s g_iobprev;
+static int g_iobmin = -1;   /* Lowest free count seen, -1 if none yet */
+static bool g_iobvalid;
+
+static struct sysmon_heap_s g_heaps[CONFIG_PYXIS_SYSMON_MEMINFO_HEAPS];
+static int g_nheaps;
+
+static struct sysmon_task_s g_tasks[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+static struct sysmon_stack_s g_stacks[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+static bool g_stackwalk;    /* Stacks gathered by the critmon walk */
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+static struct sysmon_crit_s g_crits[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+static struct sysmon_crit_s g_critcpus[NCPUS];
+static bool g_critnoreset;  /* The kernel refused to reset the maxima */
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_FLIGHTREC
+static struct sysmon_flight_s g_flight = { .armed = true };
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+static FAR struct sysmon_snapshot_s* g_snapshot;
+#endif
+static uint64_t g_lastsample;
+static uint64_t g_elapsed;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+
+/****************************************************************************
+ * Name: sysmon_write
+ ****************************************************************************/
+
+static void sysmon_write(FAR const char* buf, size_t len)
+{
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  sysmon_sink_write(buf, len);
+#else
+  fwrite(buf, 1, len, stdout);
+#endif
+  g_sysmon.nbytes += len;
+}
+
+/****************************************************************************
+ * Name: sysmon_delta_parse
+ *
+ * Description:
+ *   Split a line into the hash of its text and its first numbers.  The
+ *   numbers beyond SYSMON_DELTA_NUMS are hashed as text.
+ *
+ ****************************************************************************/
+
+static void sysmon_delta_parse(FAR const char* line,
+                               FAR struct sysmon_delta_s* delta)
+{
+  uint32_t hash = 2166136261u;
+  FAR char* endptr;
+
+  delta->nnums = 0;
+  while (*line != '\0') {
+    if (delta->nnums < SYSMON_DELTA_NUMS &&
+        (isdigit(*line) || (*line == '-' && isdigit(line[1])))) {
+      delta->nums[delta->nnums++] = strtof(line, &endptr);
+      line = endptr;
+      hash = (hash ^ '#') * 16777619u;
+      continue;
+    }
+
+    hash = (hash ^ (uint8_t)*line++) * 16777619u;
+  }
+
+  delta->hash = hash;
+}
+
+/****************************************************************************
+ * Name: sysmon_delta_changed
+ *
+ * Description:
+ *   A line changed if its text did or one of its numbers moved by more
+ *   than DELTA_EPSILON percent since it was last emitted.
+ *
+ ****************************************************************************/
+
+static bool sysmon_delta_changed(FAR const struct sysmon_delta_s* old,
+                                 FAR const struct sysmon_delta_s* now)
+{
+  if (old->hash != now->hash || old->nnums != now->nnums) {
+    return true;
+  }
+
+  for (int i = 0; i < now->nnums; i++) {
+    float diff = now->nums[i] - old->nums[i];
+    float base = old->nums[i] < 0 ? -old->nums[i] : old->nums[i];
+
+    if (diff < 0) {
+      diff = -diff;
+    }
+
+    if (diff * 100 > base * CONFIG_PYXIS_SYSMON_DELTA_EPSILON ||
+        (base == 0 && diff != 0)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: sysmon_delta_flush
+ *
+ * Description:
+ *   Emit the headings held back so far.
+ *
+ ****************************************************************************/
+
+static void sysmon_delta_flush(void)
+{
+  if (g_delta.npending > 0) {
+    sysmon_write(g_delta.pending, g_delta.npending);
+    g_delta.npending = 0;
+    g_delta.npasspending = 0;
+  }
+}
+
+/****************************************************************************
+ * Name: sysmon_delta_line
+ *
+ * Description:
+ *   Emit one complete line if it changed.  Unchanged lines without numbers
+ *   are headings, they are held back and only emitted in front of the
+ *   next changed line of the same collector.
+ *
+ ****************************************************************************/
+
+static void sysmon_delta_line(FAR const char* line, size_t len)
+{
+  FAR struct sysmon_delta_s* slot = NULL;
+  struct sysmon_delta_s now;
+  bool changed;
+
+  if (g_delta.collector < 0) {
+    /* The pass header only shows up along with a changed line */
+
+    if (g_delta.keyframe) {
+      sysmon_write(line, len);
+    } else if (g_delta.npending + len <= sizeof(g_delta.pending)) {
+      memcpy(&g_delta.pending[g_delta.npending], line, len);
+      g_delta.npending += len;
+      g_delta.npasspending = g_delta.npending;
+    }
+
+    return;
+  }
+
+  if (g_delta.nlines < CONFIG_PYXIS_SYSMON_DELTA_LINES) {
+    slot = &g_deltas[g_delta.collector][g_delta.nlines];
+  }
+
+  g_delta.nlines++;
+  sysmon_delta_parse(line, &now);
+  changed = g_delta.keyframe || slot == NULL ||
+            sysmon_delta_changed(slot, &now);
+
+  if (changed) {
+    sysmon_delta_flush();
+    sysmon_write(line, len);
+    if (slot != NULL) {
+      *slot = now;
+    }
+  } else if (now.nnums == 0 &&
+             g_delta.npending + len <= sizeof(g_delta.pending)) {
+    memcpy(&g_delta.pending[g_delta.npending], line, len);
+    g_delta.npending += len;
+  }
+}
+
+/****************************************************************************
+ * Name: sysmon_delta_begin
+ *
+ * Description:
+ *   Start filtering the output of collector c, dropping the headings the
+ *   previous collector held back.
+ *
+ ****************************************************************************/
+
+static void sysmon_delta_begin(FAR struct sysmon_collector_s* c)
+{
+  g_delta.collector = c - g_collectors;
+  g_delta.nlines = 0;
+  g_delta.npending = g_delta.npasspending;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_DELTA */
+
+/****************************************************************************
+ * Name: sysmon_printf
+ *
+ * Description:
+ *   All the sampling output goes through here so it can be accounted for.
+ *
+ ****************************************************************************/
+
+static int sysmon_printf(FAR const char* fmt, ...)
+{
+  va_list ap;
+  int ret;
+
+  va_start(ap, fmt);
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  if (g_delta.active) {
+    size_t space = sizeof(g_delta.line) - g_delta.len;
+    FAR char* endptr;
+
+    ret = vsnprintf(&g_delta.line[g_delta.len], space, fmt, ap);
+    va_end(ap);
+    if (ret <= 0) {
+      return ret;
+    }
+
+    g_delta.len += (size_t)ret < space ? (size_t)ret : space - 1;
+
+    /* Hand the complete lines to the filter, a line that does not fit in
+     * the buffer is cut.
+     */
+
+    while ((endptr = memchr(g_delta.line, '\n', g_delta.len)) != NULL ||
+           g_delta.len == sizeof(g_delta.line) - 1) {
+      size_t len = endptr != NULL ? endptr - g_delta.line + 1 : g_delta.len;
+      char saved = g_delta.line[len];
+
+      g_delta.line[len] = '\0';
+      sysmon_delta_line(g_delta.line, len);
+      g_delta.line[len] = saved;
+      g_delta.len -= len;
+      memmove(g_delta.line, &g_delta.line[len], g_delta.len + 1);
+    }
+
+    return ret;
+  }
+#endif
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  ret = sysmon_sink_vprintf(fmt, ap);
+#else
+  ret = vprintf(fmt, ap);
+#endif
+  va_end(ap);
+
+  if (ret > 0) {
+    g_sysmon.nbytes += ret;
+  }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: notectl_enable
+ ****************************************************************************/
+
+static bool notectl_enable(int flag, int notectlfd)
+{
+#ifdef CONFIG_DRIVERS_NOTECTL
+  struct note_filter_mode_s mode;
+  int oldflag;
+
+  ioctl(notectlfd, NOTECTL_GETMODE, (unsigned long)&mode);
+
+  oldflag = (mode.flag & NOTE_FILTER_MODE_FLAG_ENABLE) != 0;
+  if (flag == oldflag)
+    {
+      /* Already set */
+
+      return false;
+    }
+
+  if (flag)
+    {
+      mode.flag |= NOTE_FILTER_MODE_FLAG_ENABLE;
+    }
+  else
+    {
+      mode.flag &= ~NOTE_FILTER_MODE_FLAG_ENABLE;
+    }
+
+  ioctl(notectlfd, NOTECTL_SETMODE, (unsigned long)&mode);
+#endif
+  return true;
+}
+
+/****************************************************************************
+ * Name: sysmon_fopen
+ *
+ * Description:
+ *   Open a file for sysmon_fgets().  Returns OK or a negated errno.
+ *
+ ****************************************************************************/
+
+static int sysmon_fopen(FAR struct sysmon_file_s* file, FAR const char* path)
+{
+  file->pos = 0;
+  file->len = 0;
+  file->fd = open(path, O_RDONLY);
+  return file->fd < 0 ? -errno : OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_fgets
+ *
+ * Description:
+ *   fgets() replacement reading through the buffer of file.
+ *
+ ****************************************************************************/
+
+static FAR char* sysmon_fgets(FAR char* line, size_t size,
+                              FAR struct sysmon_file_s* file)
+{
+  size_t n = 0;
+
+  while (n < size - 1) {
+    if (file->pos == file->len) {
+      ssize_t nread;
+
+      nread = read(file->fd, file->buf, sizeof(file->buf));
+      if (nread <= 0) {
+        break;
+      }
+
+      file->pos = 0;
+      file->len = nread;
+    }
+
+    line[n] = file->buf[file->pos++];
+    if (line[n++] == '\n') {
+      break;
+    }
+  }
+
+  if (n == 0) {
+    return NULL;
+  }
+
+  line[n] = '\0';
+  return line;
+}
+
+/****************************************************************************
+ * Name: sysmon_fclose
+ ****************************************************************************/
+
+static void sysmon_fclose(FAR struct sysmon_file_s* file)
+{
+  close(file->fd);
+}
+
+/****************************************************************************
+ * Name: sysmon_isolate_value
+ ****************************************************************************/
+
+static FAR char* sysmon_isolate_value(FAR char* line)
+{
+  FAR char* ptr;
+
+  while (isblank(*line) && *line != '\0') {
+    line++;
+  }
+
+  ptr = line;
+  while (*ptr != '\n' && *ptr != '\r' && *ptr != '\0') {
+    ptr++;
+  }
+
+  *ptr = '\0';
+  return line;
+}
+
+/****************************************************************************
+ * Name: sysmon_process_directory
+ ****************************************************************************/
+
+static int sysmon_process_directory(FAR struct dirent* entryp)
+{
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  FAR struct sysmon_crit_s* crit;
+  char preempbuf[24];
+  char critbuf[24];
+#endif
+  struct sysmon_file_s file;
+  FAR const char* tmpstr;
+  FAR const char* maxpreemp;
+  FAR const char* maxcrit;
+  FAR char* endptr;
+  char filepath[SYSMON_PATH_SIZE];
+  int len;
+  int ret;
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+
+  /* Read the task status to get the task name */
+
+  name[0] = '\0';
+  snprintf(filepath, sizeof(filepath), "%s/%s/status", g_sysmon.root,
+    entryp->d_name);
+
+  /* Open the status file */
+
+  ret = sysmon_fopen(&file, filepath);
+  if (ret < 0) {
+    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
+      filepath, ret);
+    return ret;
+  }
+
+  while (sysmon_fgets(g_sysmon.line, 80, &file) != NULL) {
+    g_sysmon.line[79] = '\n';
+    len = strlen(g_name);
+    if (strncmp(g_sysmon.line, g_name, len) == 0) {
+      tmpstr = sysmon_isolate_value(&g_sysmon.line[len]);
+      if (*tmpstr == '\0') {
+        sysmon_fclose(&file);
+        return -EINVAL;
+      }
+
+      strlcpy(name, tmpstr, sizeof(name));
+    }
+  }
+
+  sysmon_fclose(&file);
+#endif
+
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+  /* Gather the stack usage in the same walk when it is due as well */
+
+  if (g_stackwalk) {
+    sysmon_stack_directory(entryp);
+  }
+#endif
+
+  /* Read critical section information */
+
+  snprintf(filepath, sizeof(filepath), "%s/%s/critmon", g_sysmon.root,
+    entryp->d_name);
+
+  /* Open the Csection file */
+
+  ret = sysmon_fopen(&file, filepath);
+  if (ret < 0) {
+    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
+      filepath, ret);
+    return ret;
+  }
+
+  /* Read the line containing the Csection max durations */
+
+  if (sysmon_fgets(g_sysmon.line, 80, &file) == NULL) {
+    ret = -errno;
+    fprintf(stderr, "System Monitor: Failed to read from %s: %d\n",
+      filepath, ret);
+    goto errout_with_file;
+  }
+
+  /* Input Format:   X.XXXXXXXXX,X.XXXXXXXXX
+  * Output Format:  X.XXXXXXXXX X.XXXXXXXXX NNNNN <name>
+  */
+
+  maxpreemp = g_sysmon.line;
+  endptr = strchr(g_sysmon.line, ',');
+
+  if (endptr != NULL) {
+    *endptr++ = '\0';
+    maxcrit = endptr;
+    endptr = strchr(endptr, '\n');
+    if (endptr != NULL) {
+      *endptr = '\0';
+    }
+  } else {
+    maxcrit = "None";
+  }
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  crit = sysmon_crit_get(atoi(entryp->d_name));
+  if (crit != NULL) {
+#if CONFIG_TASK_NAME_SIZE > 0
+    if (crit->name[0] == '\0') {
+      strlcpy(crit->name, name, sizeof(crit->name));
+    }
+#endif
+
+    /* The node is reset below, show the running maxima instead */
+
+    sysmon_crit_record(crit, maxpreemp, maxcrit);
+    maxpreemp = sysmon_crit_format(preempbuf, sizeof(preempbuf), maxpreemp,
+      crit->maxpreemp);
+    maxcrit = sysmon_crit_format(critbuf, sizeof(critbuf), maxcrit,
+      crit->maxcsection);
+  }
+#endif
+
+  /* Finally, output the stack info that we gleaned from the procfs */
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  sysmon_printf("%11s %11s %5s %s\n",
+    maxpreemp, maxcrit, entryp->d_name, name);
+#else
+  sysmon_printf("%11s %11s %5s\n",
+    maxpreemp, maxcrit, entryp->d_name);
+#endif
+
+  ret = OK;
+
+errout_with_file:
+  sysmon_fclose(&file);
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  if (ret == OK) {
+    sysmon_crit_reset(filepath);
+  }
+#endif
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_check_name
+ ****************************************************************************/
+
+static bool sysmon_check_name(FAR char* name)
+{
+  int i;
+
+  /* Check each character in the name */
+
+  for (i = 0; i < NAME_MAX && name[i] != '\0'; i++) {
+    if (!isdigit(name[i])) {
+      /* Name contains something other than a decimal numeric character */
+
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: sysmon_foreach_task
+ *
+ * Description:
+ *   Walk the top-level procfs directory and call handler for each task or
+ *   thread entry.  Returns a negated errno if the walk had to be given up.
+ *
+ ****************************************************************************/
+
+static int sysmon_foreach_task(CODE int (*handler)(FAR struct dirent*))
+{
+  FAR struct dirent* entryp;
+  DIR* dirp = g_sysmon.procdir;
+  int errcount = 0;
+  int ret = OK;
+
+  /* Open the top-level procfs directory once, later walks rewind it */
+
+  if (dirp == NULL) {
+    dirp = opendir(g_sysmon.root);
+    if (dirp == NULL) {
+      /* Failed to open the directory */
+
+      fprintf(stderr, "System Monitor: Failed to open directory: %s\n",
+        g_sysmon.root);
+      return -ENOENT;
+    }
+
+    g_sysmon.procdir = dirp;
+  } else {
+    rewinddir(dirp);
+  }
+
+  /* Read each directory entry */
+
+  while ((entryp = readdir(dirp)) != NULL) {
+    /* Task/thread entries in the /proc directory will all be (1)
+     * directories with (2) all numeric names.
+     */
+
+    if (!DIRENT_ISDIRECTORY(entryp->d_type) ||
+        !sysmon_check_name(entryp->d_name)) {
+      continue;
+    }
+
+    /* Looks good -- process the directory */
+
+    if (handler(entryp) < 0) {
+      /* Failed to process the thread directory */
+
+      fprintf(stderr, "System Monitor: Failed to process sub-directory: %s\n",
+        entryp->d_name);
+
+      if (++errcount > 100) {
+        fprintf(stderr, "System Monitor: Too many errors ... exiting\n");
+        ret = -EIO;
+        break;
+      }
+    }
+  }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_clock
+ *
+ * Description:
+ *   Return the monotonic time in nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t sysmon_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: sysmon_read_file
+ *
+ * Description:
+ *   Read up to size - 1 bytes of a file into buffer and NUL terminate it.
+ *   Returns the number of bytes read or a negated errno.
+ *
+ ****************************************************************************/
+
+static int sysmon_read_file(FAR const char* path, FAR char* buffer,
+                            size_t size)
+{
+  ssize_t nread;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  nread = read(fd, buffer, size - 1);
+  close(fd);
+  if (nread < 0) {
+    return -errno;
+  }
+
+  buffer[nread] = '\0';
+  return nread;
+}
+
+/****************************************************************************
+ * Name: sysmon_read_proc
+ *
+ * Description:
+ *   sysmon_read_file() of a node at the top of the procfs tree.
+ *
+ ****************************************************************************/
+
+static int sysmon_read_proc(FAR const char* node, FAR char* buffer,
+                            size_t size)
+{
+  char path[SYSMON_PATH_SIZE];
+
+  snprintf(path, sizeof(path), "%s/%s", g_sysmon.root, node);
+  return sysmon_read_file(path, buffer, size);
+}
+
+/****************************************************************************
+ * Name: sysmon_read_node
+ *
+ * Description:
+ *   Read the first line of the procfs node <mountpoint>/<dir>/<node> into
+ *   buffer.  Returns the number of bytes read or a negated errno.
+ *
+ ****************************************************************************/
+
+static int sysmon_read_node(FAR const char* dir, FAR const char* node,
+                            FAR char* buffer, size_t size)
+{
+  char path[SYSMON_PATH_SIZE];
+  FAR char* endptr;
+  int ret;
+
+  snprintf(path, sizeof(path), "%s/%s/%s", g_sysmon.root, dir, node);
+
+  ret = sysmon_read_file(path, buffer, size);
+  if (ret > 0) {
+    endptr = strchr(buffer, '\n');
+    if (endptr != NULL) {
+      *endptr = '\0';
+    }
+  }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_parse_time
+ *
+ * Description:
+ *   Convert a "S.NNNNNNNNN" procfs time stamp into nanoseconds.
+ *
+ ****************************************************************************/
+
+static bool sysmon_parse_time(FAR const char* str, FAR uint64_t* ns)
+{
+  unsigned long sec;
+  unsigned long nsec;
+
+  if (sscanf(str, "%lu.%lu", &sec, &nsec) != 2) {
+    return false;
+  }
+
+  *ns = sec * NSEC_PER_SEC + nsec;
+  return true;
+}
+
+/****************************************************************************
+ * Name: sysmon_parse_iobinfo
+ *
+ * Description:
+ *   Parse the content of /proc/iobinfo and keep track of the lowest free
+ *   count ever seen.  Input Format: a header line, then
+ *   NTOTAL NFREE NWAIT NTHROTTLE
+ *
+ ****************************************************************************/
+
+static bool sysmon_parse_iobinfo(FAR const char* buffer,
+                                 FAR struct sysmon_iob_s* iob)
+{
+  FAR const char* line = strchr(buffer, '\n');
+
+  if (line == NULL || sscanf(line, "%d %d %d %d", &iob->ntotal,
+                             &iob->nfree, &iob->nwait,
+                             &iob->nthrottle) != 4) {
+    return false;
+  }
+
+  if (g_iobmin < 0 || iob->nfree < g_iobmin) {
+    g_iobmin = iob->nfree;
+  }
+
+  return true;
+}
+
+#if CONFIG_TASK_NAME_SIZE > 0
+
+/****************************************************************************
+ * Name: sysmon_read_name
+ *
+ * Description:
+ *   Copy the task name from <mountpoint>/<dir>/status into name.
+ *
+ ****************************************************************************/
+
+static void sysmon_read_name(FAR const char* dir, FAR char* name,
+                             size_t size)
+{
+  struct sysmon_file_s file;
+  int len = strlen(g_name);
+  char line[80];
+
+  snprintf(line, sizeof(line), "%s/%s/status", g_sysmon.root, dir);
+  if (sysmon_fopen(&file, line) < 0) {
+    return;
+  }
+
+  while (sysmon_fgets(line, sizeof(line), &file) != NULL) {
+    if (strncmp(line, g_name, len) == 0) {
+      strlcpy(name, sysmon_isolate_value(&line[len]), size);
+      break;
+    }
+  }
+
+  sysmon_fclose(&file);
+}
+#endif
+
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+
+/****************************************************************************
+ * Name: sysmon_task_get
+ ****************************************************************************/
+
+static FAR struct sysmon_task_s* sysmon_task_get(pid_t pid)
+{
+  FAR struct sysmon_task_s* freeslot = NULL;
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_tasks[i].pid == pid) {
+      return &g_tasks[i];
+    } else if (g_tasks[i].pid < 0 && freeslot == NULL) {
+      freeslot = &g_tasks[i];
+    }
+  }
+
+  if (freeslot != NULL) {
+    memset(freeslot, 0, sizeof(*freeslot));
+    freeslot->pid = pid;
+  }
+
+  return freeslot;
+}
+
+/****************************************************************************
+ * Name: sysmon_load_directory
+ *
+ * Description:
+ *   Update the CPU share of one task.  The share is the delta of the
+ *   cumulative run time reported by <pid>/critmon divided by the time
+ *   elapsed since the previous sample.  Kernels without the run time field
+ *   fall back to the averaged value from <pid>/loadavg.
+ *
+ ****************************************************************************/
+
+static int sysmon_load_directory(FAR struct dirent* entryp)
+{
+  FAR struct sysmon_task_s* task;
+  FAR char* field;
+  uint64_t runtime;
+  char line[80];
+  int whole;
+  int frac;
+
+  task = sysmon_task_get(atoi(entryp->d_name));
+  if (task == NULL) {
+    /* The task table is full, the task is left out of this sample */
+
+    return OK;
+  }
+
+  task->seen = true;
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  if (task->name[0] == '\0') {
+    sysmon_read_name(entryp->d_name, task->name, sizeof(task->name));
+  }
+#endif
+
+  /* Input Format: MAXPREEMP,MAXCSECTION,MAXRUN,RUNTIME */
+
+  if (sysmon_read_node(entryp->d_name, "critmon", line, sizeof(line)) > 0) {
+    field = line;
+    for (int i = 0; i < 3 && field != NULL; i++) {
+      field = strchr(field, ',');
+      if (field != NULL) {
+        field++;
+      }
+    }
+
+    if (field != NULL && sysmon_parse_time(field, &runtime)) {
+      bool valid = task->has_runtime && g_elapsed > 0 &&
+                   runtime >= task->runtime;
+
+      if (valid) {
+        task->load = (runtime - task->runtime) * 1000 / g_elapsed;
+        if (task->load > 1000) {
+          task->load = 1000;
+        }
+      }
+
+      task->has_runtime = true;
+      task->runtime = runtime;
+      if (valid) {
+        return OK;
+      }
+    }
+  }
+
+  /* No delta yet, use the kernel's own average.  Input Format: XXX.X% */
+
+  if (sysmon_read_node(entryp->d_name, "loadavg", line, sizeof(line)) > 0 &&
+      sscanf(line, "%d.%d", &whole, &frac) == 2) {
+    task->load = whole * 10 + frac;
+  }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_load_compare
+ ****************************************************************************/
+
+static int sysmon_load_compare(FAR const void* a, FAR const void* b)
+{
+  FAR const struct sysmon_task_s* ta = *(FAR struct sysmon_task_s* const*)a;
+  FAR const struct sysmon_task_s* tb = *(FAR struct sysmon_task_s* const*)b;
+
+  return tb->load - ta->load;
+}
+
+/****************************************************************************
+ * Name: sysmon_topload_sample
+ ****************************************************************************/
+
+static int sysmon_topload_sample(FAR struct sysmon_collector_s* c)
+{
+  uint64_t now = sysmon_clock();
+  int ret;
+
+  if (g_lastsample != 0) {
+    g_elapsed = now - g_lastsample;
+  }
+
+  g_lastsample = now;
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    g_tasks[i].seen = false;
+  }
+
+  ret = sysmon_foreach_task(sysmon_load_directory);
+
+  /* Release the slots of the tasks that have exited */
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_tasks[i].pid >= 0 && !g_tasks[i].seen) {
+      g_tasks[i].pid = -1;
+    }
+  }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_topload_emit
+ ****************************************************************************/
+
+static int sysmon_topload_emit(FAR struct sysmon_collector_s* c)
+{
+  FAR struct sysmon_task_s* top[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+  int ntasks = 0;
+
+  /* In NuttX, PID number less than NCPUS are the idle tasks, so the load
+   * of each CPU is whatever its idle task did not use.
+   */
+
+  sysmon_printf("Per-CPU load:\n");
+  for (int cpu = 0; cpu < NCPUS; cpu++) {
+    for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+      if (g_tasks[i].pid == cpu) {
+        int load = 1000 - g_tasks[i].load;
+        sysmon_printf("CPU%d: %3d.%d%%\n", cpu, load / 10, load % 10);
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_tasks[i].pid >= NCPUS) {
+      top[ntasks++] = &g_tasks[i];
+    }
+  }
+
+  qsort(top, ntasks, sizeof(top[0]), sysmon_load_compare);
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  sysmon_printf("  PID   LOAD DESCRIPTION\n");
+#else
+  sysmon_printf("  PID   LOAD\n");
+#endif
+  for (int i = 0; i < ntasks && i < CONFIG_PYXIS_SYSMON_TOPLOAD_NTASKS; i++) {
+#if CONFIG_TASK_NAME_SIZE > 0
+    sysmon_printf("%5d %3d.%d%% %s\n", top[i]->pid, top[i]->load / 10,
+      top[i]->load % 10, top[i]->name);
+#else
+    sysmon_printf("%5d %3d.%d%%\n", top[i]->pid, top[i]->load / 10,
+      top[i]->load % 10);
+#endif
+  }
+
+  return OK;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_TOPLOAD */
+
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+
+/****************************************************************************
+ * Name: sysmon_stack_directory
+ *
+ * Description:
+ *   Record the stack size and high water mark of one task.  Input Format:
+ *
+ *     StackBase:  0xXXXXXXXX
+ *     StackSize:  NNNN
+ *     StackUsed:  NNNN        (or MaxStackUsed: on newer kernels)
+ *
+ ****************************************************************************/
+
+static int sysmon_stack_directory(FAR struct dirent* entryp)
+{
+  FAR struct sysmon_stack_s* freeslot = NULL;
+  FAR struct sysmon_stack_s* stack = NULL;
+  pid_t pid = atoi(entryp->d_name);
+  FAR char* field;
+  char buf[160];
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_stacks[i].pid == pid) {
+      stack = &g_stacks[i];
+      break;
+    } else if (g_stacks[i].pid < 0 && freeslot == NULL) {
+      freeslot = &g_stacks[i];
+    }
+  }
+
+  if (stack == NULL) {
+    if (freeslot == NULL) {
+      /* The table is full, the task is left out of this sample */
+
+      return OK;
+    }
+
+    stack = freeslot;
+    memset(stack, 0, sizeof(*stack));
+    stack->pid = pid;
+#if CONFIG_TASK_NAME_SIZE > 0
+    sysmon_read_name(entryp->d_name, stack->name, sizeof(stack->name));
+#endif
+  }
+
+  snprintf(buf, sizeof(buf), "%s/%s/stack", g_sysmon.root,
+    entryp->d_name);
+  if (sysmon_read_file(buf, buf, sizeof(buf)) <= 0) {
+    return -ENOENT;
+  }
+
+  field = strstr(buf, "StackSize:");
+  if (field == NULL) {
+    return -EINVAL;
+  }
+
+  stack->seen = true;
+  stack->size = strtoul(field + sizeof("StackSize:") - 1, NULL, 10);
+  field = strstr(buf, "StackUsed:");
+  stack->used = field != NULL ?
+                strtoul(field + sizeof("StackUsed:") - 1, NULL, 10) : 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_stack_compare
+ ****************************************************************************/
+
+static int sysmon_stack_compare(FAR const void* a, FAR const void* b)
+{
+  FAR const struct sysmon_stack_s* sa = *(FAR struct sysmon_stack_s* const*)a;
+  FAR const struct sysmon_stack_s* sb = *(FAR struct sysmon_stack_s* const*)b;
+  long ha = (long)sa->size - (long)sa->used;
+  long hb = (long)sb->size - (long)sb->used;
+
+  return ha < hb ? -1 : ha > hb;
+}
+
+/****************************************************************************
+ * Name: sysmon_stack_sample
+ *
+ * Description:
+ *   Refresh the stack table.  The critmon collector gathers the stacks in
+ *   its own task walk when both are due in the same pass, otherwise walk
+ *   the tasks here.
+ *
+ ****************************************************************************/
+
+static int sysmon_stack_sample(FAR struct sysmon_collector_s* c)
+{
+  int ret = OK;
+
+  if (!g_stackwalk) {
+    for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+      g_stacks[i].seen = false;
+    }
+
+    ret = sysmon_foreach_task(sysmon_stack_directory);
+  }
+
+  g_stackwalk = false;
+
+  /* Forget the tasks that went away */
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (!g_stacks[i].seen) {
+      g_stacks[i].pid = -1;
+    }
+  }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: sysmon_stack_emit
+ *
+ * Description:
+ *   List the tasks by ascending stack headroom and flag those whose high
+ *   water mark is above PYXIS_SYSMON_STACK_THRESHOLD percent of the stack.
+ *
+ ****************************************************************************/
+
+static int sysmon_stack_emit(FAR struct sysmon_collector_s* c)
+{
+  FAR struct sysmon_stack_s* list[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+  int nstacks = 0;
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_stacks[i].pid >= 0 && g_stacks[i].size > 0) {
+      list[nstacks++] = &g_stacks[i];
+    }
+  }
+
+  qsort(list, nstacks, sizeof(list[0]), sysmon_stack_compare);
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  sysmon_printf("  PID   SIZE   PEAK HEADROOM  USAGE   DESCRIPTION\n");
+#else
+  sysmon_printf("  PID   SIZE   PEAK HEADROOM  USAGE\n");
+#endif
+  for (int i = 0; i < nstacks; i++) {
+    FAR struct sysmon_stack_s* stack = list[i];
+    int usage = stack->used * 1000 / stack->size;
+    FAR const char* flag =
+      usage >= CONFIG_PYXIS_SYSMON_STACK_THRESHOLD * 10 ? "!!" : "  ";
+
+#if CONFIG_TASK_NAME_SIZE > 0
+    sysmon_printf("%5d %6zu %6zu %8ld %3d.%d%% %s %s\n", stack->pid,
+      stack->size, stack->used, (long)stack->size - (long)stack->used,
+      usage / 10, usage % 10, flag, stack->name);
+#else
+    sysmon_printf("%5d %6zu %6zu %8ld %3d.%d%% %s\n", stack->pid,
+      stack->size, stack->used, (long)stack->size - (long)stack->used,
+      usage / 10, usage % 10, flag);
+#endif
+  }
+
+  return OK;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_STACK */
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+
+/****************************************************************************
+ * Name: sysmon_crit_get
+ *
+ * Description:
+ *   Return the distribution slot of a task, allocating one on first sight.
+ *   NULL when the table is full.
+ *
+ ****************************************************************************/
+
+static FAR struct sysmon_crit_s* sysmon_crit_get(pid_t pid)
+{
+  FAR struct sysmon_crit_s* freeslot = NULL;
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_crits[i].pid == pid) {
+      g_crits[i].seen = true;
+      return &g_crits[i];
+    } else if (g_crits[i].pid < 0 && freeslot == NULL) {
+      freeslot = &g_crits[i];
+    }
+  }
+
+  if (freeslot != NULL) {
+    memset(freeslot, 0, sizeof(*freeslot));
+    freeslot->pid = pid;
+    freeslot->seen = true;
+  }
+
+  return freeslot;
+}
+
+/****************************************************************************
+ * Name: sysmon_crit_record
+ *
+ * Description:
+ *   Account the maxima of one interval.  Kernels that cannot reset the
+ *   maxima only tell when the lifetime maximum grew, the other intervals
+ *   are counted but left out of the histogram.
+ *
+ ****************************************************************************/
+
+static void sysmon_crit_record(FAR struct sysmon_crit_s* crit,
+                               FAR const char* maxpreemp,
+                               FAR const char* maxcrit)
+{
+  uint64_t preemp = 0;
+  uint64_t csection = 0;
+  uint32_t worst;
+  uint32_t limit;
+  int bucket;
+
+  sysmon_parse_time(maxpreemp, &preemp);
+  sysmon_parse_time(maxcrit, &csection);
+  if (preemp > crit->maxpreemp) {
+    crit->maxpreemp = preemp;
+  }
+
+  if (csection > crit->maxcsection) {
+    crit->maxcsection = csection;
+  }
+
+  crit->preemp = preemp / 1000;
+  crit->csection = csection / 1000;
+  worst = crit->preemp > crit->csection ? crit->preemp : crit->csection;
+
+  /* The first read covers everything since boot, it only arms the reset */
+
+  if (!crit->primed) {
+    crit->primed = true;
+    crit->lifetime = worst;
+    return;
+  }
+
+  crit->nintervals++;
+  if (g_critnoreset) {
+    if (worst <= crit->lifetime) {
+      return;
+    }
+
+    crit->lifetime = worst;
+  }
+
+  bucket = 0;
+  limit = 10;
+  while (bucket < SYSMON_CRIT_BUCKETS - 1 && worst >= limit) {
+    limit *= 10;
+    bucket++;
+  }
+
+  crit->hist[bucket]++;
+  if (worst > CONFIG_PYXIS_SYSMON_CRITDIST_BUDGET) {
+    crit->nover++;
+  }
+}
+
+/****************************************************************************
+ * Name: sysmon_crit_reset
+ *
+ * Description:
+ *   Zero the maxima of a critmon node by writing to it, so the next read
+ *   only covers the next interval.
+ *
+ ****************************************************************************/
+
+static void sysmon_crit_reset(FAR const char* path)
+{
+  int fd;
+
+  if (g_critnoreset) {
+    return;
+  }
+
+  fd = open(path, O_WRONLY);
+  if (fd < 0 || write(fd, "0", 1) != 1) {
+    g_critnoreset = true;
+  }
+
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+/****************************************************************************
+ * Name: sysmon_crit_format
+ *
+ * Description:
+ *   Format a running maximum the way critmon prints its times.  A value
+ *   that did not parse, such as "None", is returned unchanged.
+ *
+ ****************************************************************************/
+
+static FAR const char* sysmon_crit_format(FAR char* buffer, size_t size,
+                                          FAR const char* value,
+                                          uint64_t max)
+{
+  uint64_t ns;
+
+  if (!sysmon_parse_time(value, &ns)) {
+    return value;
+  }
+
+  snprintf(buffer, size, "%" PRIu64 ".%09" PRIu64,
+    (uint64_t)(max / NSEC_PER_SEC), (uint64_t)(max % NSEC_PER_SEC));
+  return buffer;
+}
+
+/****************************************************************************
+ * Name: sysmon_crit_print
+ ****************************************************************************/
+
+static void sysmon_crit_print(FAR const char* id,
+                              FAR const struct sysmon_crit_s* crit,
+                              FAR const char* name)
+{
+  sysmon_printf("%6s %6lu %6lu %6lu %6lu %6lu %7lu/%-7lu %s\n", id,
+    crit->hist[0], crit->hist[1], crit->hist[2], crit->hist[3],
+    crit->hist[4], crit->nover, crit->nintervals, name);
+}
+
+/****************************************************************************
+ * Name: sysmon_crit_emit
+ *
+ * Description:
+ *   Print the histogram of the interval maxima of every CPU and task, and
+ *   how many intervals went over PYXIS_SYSMON_CRITDIST_BUDGET.
+ *
+ ****************************************************************************/
+
+static void sysmon_crit_emit(void)
+{
+  char id[12];
+
+  sysmon_printf("INTERVAL MAXIMA%s, BUDGET %dus\n",
+    g_critnoreset ? " (NO RESET, GROWTH ONLY)" : "",
+    CONFIG_PYXIS_SYSMON_CRITDIST_BUDGET);
+  sysmon_printf("    ID  <10us <100us   <1ms  <10ms >=10ms    OVER/INTERVALS\n");
+
+  for (int cpu = 0; cpu < NCPUS; cpu++) {
+    if (g_critcpus[cpu].seen) {
+      snprintf(id, sizeof(id), "CPU%d", cpu);
+      sysmon_crit_print(id, &g_critcpus[cpu], "");
+    }
+  }
+
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    FAR struct sysmon_crit_s* crit = &g_crits[i];
+
+    if (crit->pid < 0) {
+      continue;
+    }
+
+    /* Forget the tasks that went away */
+
+    if (!crit->seen) {
+      crit->pid = -1;
+      continue;
+    }
+
+    snprintf(id, sizeof(id), "%d", crit->pid);
+#if CONFIG_TASK_NAME_SIZE > 0
+    sysmon_crit_print(id, crit, crit->name);
+#else
+    sysmon_crit_print(id, crit, "");
+#endif
+  }
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_CRITDIST */
+
+/****************************************************************************
+ * Name: sysmon_global_crit
+ ****************************************************************************/
+
+static void sysmon_global_crit(void)
+{
+  struct sysmon_file_s file;
+  char filepath[SYSMON_PATH_SIZE];
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  char preempbuf[24];
+  char critbuf[24];
+#endif
+  FAR char* cpu;
+  FAR const char* maxpreemp;
+  FAR const char* maxcrit;
+  FAR char* endptr;
+  int ret;
+
+  /* Open the Csection file */
+
+  snprintf(filepath, sizeof(filepath), "%s/critmon", g_sysmon.root);
+  ret = sysmon_fopen(&file, filepath);
+  if (ret < 0) {
+    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
+      filepath, ret);
+    return;
+  }
+
+  /* Read the line containing the Csection max durations for each CPU */
+
+  while (sysmon_fgets(g_sysmon.line, 80, &file) != NULL) {
+    /* Input Format:  X,X.XXXXXXXXX,X.XXXXXXXXX
+    * Output Format: X.XXXXXXXXX X.XXXXXXXXX       CPU X
+    */
+
+    cpu = g_sysmon.line;
+    endptr = strchr(g_sysmon.line, ',');
+
+    if (endptr != NULL) {
+      *endptr++ = '\0';
+      maxpreemp = endptr;
+      endptr = strchr(endptr, ',');
+      if (endptr != NULL) {
+        *endptr++ = '\0';
+        maxcrit = endptr;
+        endptr = strchr(endptr, '\n');
+        if (endptr != NULL) {
+          *endptr = '\0';
+        }
+      } else {
+        maxcrit = "None";
+      }
+    } else {
+      maxpreemp = "None";
+      maxcrit = "None";
+    }
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+    ret = atoi(cpu);
+    if (ret >= 0 && ret < NCPUS) {
+      FAR struct sysmon_crit_s* crit = &g_critcpus[ret];
+
+      /* The node is reset below, show the running maxima instead */
+
+      crit->seen = true;
+      sysmon_crit_record(crit, maxpreemp, maxcrit);
+      maxpreemp = sysmon_crit_format(preempbuf, sizeof(preempbuf),
+        maxpreemp, crit->maxpreemp);
+      maxcrit = sysmon_crit_format(critbuf, sizeof(critbuf), maxcrit,
+        crit->maxcsection);
+    }
+#endif
+
+    /* Finally, output the stack info that we gleaned from the procfs */
+
+    sysmon_printf("%11s %11s  ---  CPU %s\n", maxpreemp, maxcrit, cpu);
+  }
+
+  sysmon_fclose(&file);
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  sysmon_crit_reset(filepath);
+#endif
+}
+
+#ifdef SYSMON_HAVE_PROBE
+
+/****************************************************************************
+ * Name: sysmon_probe
+ *
+ * Description:
+ *   Collect the cheap metrics used by the triggers.  Each one costs a
+ *   single read of a small procfs node, or no system call at all.
+ *
+ ****************************************************************************/
+
+static void sysmon_probe(FAR struct sysmon_sample_s* sample)
+{
+  struct sysmon_iob_s iob;
+  struct mallinfo mem;
+  uint64_t ns;
+  FAR char* line;
+  char buffer[128];
+  int whole;
+  int frac;
+
+  sample->time = sysmon_clock();
+  sample->cpuload = -1;
+  sample->iobfree = -1;
+  sample->critmax = -1;
+
+  /* Input Format: XXX.X% */
+
+  if (sysmon_read_proc("cpuload", buffer, sizeof(buffer)) > 0 &&
+      sscanf(buffer, "%d.%d", &whole, &frac) == 2) {
+    sample->cpuload = whole * 10 + frac;
+  }
+
+  mem = mallinfo();
+  sample->memfree = mem.fordblks;
+
+  if (sysmon_read_proc("iobinfo", buffer, sizeof(buffer)) > 0 &&
+      sysmon_parse_iobinfo(buffer, &iob)) {
+    sample->iobfree = iob.nfree;
+  }
+
+  /* Input Format: CPU,MAXPREEMP,MAXCSECTION per line */
+
+  if (sysmon_read_proc("critmon", buffer, sizeof(buffer)) > 0) {
+    FAR char* saveptr;
+
+    for (line = strtok_r(buffer, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+      while ((line = strchr(line, ',')) != NULL) {
+        line++;
+        if (sysmon_parse_time(line, &ns) &&
+            (long)(ns / 1000) > sample->critmax) {
+          sample->critmax = ns / 1000;
+        }
+      }
+    }
+  }
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  /* The critmon collector resets the node, add the maxima it took away */
+
+  for (int cpu = 0; cpu < NCPUS; cpu++) {
+    ns = g_critcpus[cpu].maxpreemp > g_critcpus[cpu].maxcsection ?
+         g_critcpus[cpu].maxpreemp : g_critcpus[cpu].maxcsection;
+    if (g_critcpus[cpu].seen && (long)(ns / 1000) > sample->critmax) {
+      sample->critmax = ns / 1000;
+    }
+  }
+#endif
+}
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+
+/****************************************************************************
+ * Name: sysmon_remote_print
+ *
+ * Description:
+ *   Print one line of the merged timeline.  The time is on the clock of
+ *   the primary.
+ *
+ ****************************************************************************/
+
+static void sysmon_remote_print(FAR const char* core,
+                                FAR const struct sysmon_remote_sample_s* s)
+{
+  char load[16] = "-";
+
+  if (s->cpuload >= 0) {
+    snprintf(load, sizeof(load), "%d.%d%%", (int)s->cpuload / 10,
+      (int)s->cpuload % 10);
+  }
+
+  sysmon_printf("%5lu.%03lu %-8s cpuload %6s memfree %" PRId64
+    " iobfree %" PRId32 " critmax %" PRId32 "us\n",
+    (unsigned long)(s->time / NSEC_PER_SEC),
+    (unsigned long)(s->time % NSEC_PER_SEC / NSEC_PER_MSEC), core, load,
+    s->memfree, s->iobfree, s->critmax);
+}
+
+/****************************************************************************
+ * Name: sysmon_remote_sample
+ *
+ * Description:
+ *   Hand the probe sample of this core to the remote link.  The primary
+ *   then prints the merged samples of all the cores that are ready.
+ *
+ ****************************************************************************/
+
+static void sysmon_remote_sample(FAR const struct sysmon_sample_s* sample,
+                                 uint64_t now)
+{
+  struct sysmon_remote_sample_s remote;
+
+  remote.time = sample->time;
+  remote.cpuload = sample->cpuload;
+  remote.memfree = sample->memfree;
+  remote.iobfree = sample->iobfree;
+  remote.critmax = sample->critmax;
+  sysmon_remote_submit(&remote);
+
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE_PRIMARY
+  sysmon_remote_merge(now, sysmon_remote_print);
+#endif
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_REMOTE */
+
+#endif /* SYSMON_HAVE_PROBE */
+
+#ifdef CONFIG_PYXIS_SYSMON_ADAPTIVE
+
+/****************************************************************************
+ * Name: sysmon_tripped
+ *
+ * Description:
+ *   Check a probed sample against the configured thresholds.  A zero
+ *   threshold disables the corresponding trigger.
+ *
+ ****************************************************************************/
+
+static bool sysmon_tripped(FAR const struct sysmon_sample_s* sample)
+{
+  return (CONFIG_PYXIS_SYSMON_TRIGGER_CPULOAD > 0 &&
+          sample->cpuload >= CONFIG_PYXIS_SYSMON_TRIGGER_CPULOAD * 10) ||
+         (CONFIG_PYXIS_SYSMON_TRIGGER_MEMFREE > 0 &&
+          sample->memfree < CONFIG_PYXIS_SYSMON_TRIGGER_MEMFREE) ||
+         (CONFIG_PYXIS_SYSMON_TRIGGER_IOBFREE > 0 && sample->iobfree >= 0 &&
+          sample->iobfree < CONFIG_PYXIS_SYSMON_TRIGGER_IOBFREE) ||
+         (CONFIG_PYXIS_SYSMON_TRIGGER_CRITMON > 0 &&
+          sample->critmax >= CONFIG_PYXIS_SYSMON_TRIGGER_CRITMON);
+}
+
+/****************************************************************************
+ * Name: sysmon_adapt
+ *
+ * Description:
+ *   Pick the period of the next tick.  A trip switches straight to the
+ *   burst period.  Once no trigger fired for BURST_HOLD ticks the period
+ *   doubles on every tick until it is back at the idle interval.
+ *
+ ****************************************************************************/
+
+static void sysmon_adapt(FAR const struct sysmon_sample_s* sample)
+{
+  if (sysmon_tripped(sample)) {
+    if (g_sysmon.period == SYSMON_IDLE_PERIOD) {
+      printf("System Monitor: Trigger tripped, burst sampling\n");
+    }
+
+    g_sysmon.period = CONFIG_PYXIS_SYSMON_BURST_INTERVAL;
+    g_sysmon.calm = 0;
+  } else if (g_sysmon.period < SYSMON_IDLE_PERIOD &&
+             ++g_sysmon.calm > CONFIG_PYXIS_SYSMON_BURST_HOLD) {
+    g_sysmon.period *= 2;
+    if (g_sysmon.period >= SYSMON_IDLE_PERIOD) {
+      g_sysmon.period = SYSMON_IDLE_PERIOD;
+      printf("System Monitor: Back to idle sampling\n");
+    }
+  }
+}
+
+/****************************************************************************
+ * Name: sysmon_print_sample
+ ****************************************************************************/
+
+static void sysmon_print_sample(FAR const struct sysmon_sample_s* sample)
+{
+  sysmon_printf("Burst: %lu.%03lu cpuload %3d.%d%% memfree %ld "
+    "iobfree %d critmax %ldus\n",
+    (unsigned long)(sample->time / NSEC_PER_SEC),
+    (unsigned long)(sample->time % NSEC_PER_SEC / NSEC_PER_MSEC),
+    sample->cpuload / 10, sample->cpuload % 10, sample->memfree,
+    sample->iobfree, sample->critmax);
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_ADAPTIVE */
+
+#ifdef CONFIG_PYXIS_SYSMON_FLIGHTREC
+
+/****************************************************************************
+ * Name: sysmon_flight_task
+ *
+ * Description:
+ *   Write one line of the task table into the snapshot being recorded.
+ *
+ ****************************************************************************/
+
+static int sysmon_flight_task(FAR struct dirent* entryp)
+{
+  FAR const char* name = "";
+  FAR const char* state = "";
+  char status[256];
+  char path[SYSMON_PATH_SIZE];
+  char load[16];
+  FAR char* line;
+  FAR char* saveptr;
+
+  if (sysmon_read_node(entryp->d_name, "loadavg", load, sizeof(load)) < 0) {
+    load[0] = '\0';
+  }
+
+  /* sysmon_read_node() stops at the first line, the whole file is needed */
+
+  snprintf(path, sizeof(path), "%s/%s/status", g_sysmon.root,
+    entryp->d_name);
+  if (sysmon_read_file(path, status, sizeof(status)) > 0) {
+    for (line = strtok_r(status, "\n", &saveptr); line != NULL;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+      if (strncmp(line, "Name:", 5) == 0) {
+        name = sysmon_isolate_value(line + 5);
+      } else if (strncmp(line, "State:", 6) == 0) {
+        state = sysmon_isolate_value(line + 6);
+      }
+    }
+  }
+
+  fprintf(g_flight.out, "%5s %8s %-10s %s\n", entryp->d_name,
+    sysmon_isolate_value(load), state, name);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_flight_snapshot
+ *
+ * Description:
+ *   Persist the sample history, the task table and the current trace
+ *   buffer.  Tracing is stopped first so the notes describing the cause are
+ *   not overwritten while the snapshot is written.  Reading the trace
+ *   consumes it, so the next interval listing starts from an empty buffer.
+ *
+ ****************************************************************************/
+
+static void sysmon_flight_snapshot(FAR const char* reason)
+{
+  char path[64];
+  unsigned int slot;
+
+  if (notectl.enabled) {
+    notectl_enable(false, notectlfd);
+  }
+
+  /* Only the last RETAIN snapshots are kept, older ones are overwritten */
+
+  mkdir(CONFIG_PYXIS_SYSMON_FLIGHTREC_PATH, 0777);
+  slot = g_flight.nsnaps % CONFIG_PYXIS_SYSMON_FLIGHTREC_RETAIN;
+  snprintf(path, sizeof(path), CONFIG_PYXIS_SYSMON_FLIGHTREC_PATH
+    "/snapshot%u.txt", slot);
+
+  g_flight.out = fopen(path, "w");
+  if (g_flight.out == NULL) {
+    fprintf(stderr, "System Monitor: Failed to open %s: %d\n", path, errno);
+    return;
+  }
+
+  g_flight.nsnaps++;
+  fprintf(g_flight.out, "Snapshot %u: %s\n\n", g_flight.nsnaps, reason);
+
+  fprintf(g_flight.out, "Samples:\n");
+  fprintf(g_flight.out, "        TIME   LOAD    MEMFREE IOBFREE  CRITMAX\n");
+  for (unsigned int i = 0; i < g_flight.nsamples; i++) {
+    FAR struct sysmon_sample_s* sample;
+
+    slot = (g_flight.head + CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES -
+            g_flight.nsamples + i) % CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES;
+    sample = &g_flight.history[slot];
+    fprintf(g_flight.out, "%8lu.%03lu %4d.%d%% %10ld %7d %7ldus\n",
+      (unsigned long)(sample->time / NSEC_PER_SEC),
+      (unsigned long)(sample->time % NSEC_PER_SEC / NSEC_PER_MSEC),
+      sample->cpuload / 10, sample->cpuload % 10, sample->memfree,
+      sample->iobfree, sample->critmax);
+  }
+
+  fprintf(g_flight.out, "\nTasks:\n");
+  fprintf(g_flight.out, "  PID     LOAD STATE      NAME\n");
+  sysmon_foreach_task(sysmon_flight_task);
+
+  fprintf(g_flight.out, "\nProcesses switch info:\n");
+  fprintf(g_flight.out,
+    "[CPU] Time:   Prev_task-PID State ==> Next_task-PID\n");
+  (void)sysmon_trace_dump(g_flight.out);
+
+  fclose(g_flight.out);
+  g_flight.out = NULL;
+  printf("System Monitor: %s, snapshot saved to %s\n", reason, path);
+}
+
+/****************************************************************************
+ * Name: sysmon_flight_record
+ *
+ * Description:
+ *   Append a sample to the history and take a snapshot on the rising edge
+ *   of a trigger.  At most FLIGHTREC_MAX snapshots are taken per boot.
+ *
+ ****************************************************************************/
+
+static void sysmon_flight_record(FAR const struct sysmon_sample_s* sample)
+{
+  FAR const char* reason = NULL;
+  char buffer[48];
+
+  g_flight.history[g_flight.head] = *sample;
+  g_flight.head = (g_flight.head + 1) % CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES;
+  if (g_flight.nsamples < CONFIG_PYXIS_SYSMON_FLIGHTREC_SAMPLES) {
+    g_flight.nsamples++;
+  }
+
+  if (CONFIG_PYXIS_SYSMON_FLIGHTREC_CPULOAD > 0 &&
+      sample->cpuload >= CONFIG_PYXIS_SYSMON_FLIGHTREC_CPULOAD * 10) {
+    snprintf(buffer, sizeof(buffer), "cpuload %d.%d%%",
+      sample->cpuload / 10, sample->cpuload % 10);
+    reason = buffer;
+  } else if (CONFIG_PYXIS_SYSMON_FLIGHTREC_CRITMON > 0 &&
+             sample->critmax >= CONFIG_PYXIS_SYSMON_FLIGHTREC_CRITMON) {
+    snprintf(buffer, sizeof(buffer), "critmon max %ldus", sample->critmax);
+    reason = buffer;
+  }
+
+  if (reason == NULL) {
+    g_flight.armed = true;
+    return;
+  } else if (!g_flight.armed) {
+    return;
+  }
+
+  g_flight.armed = false;
+  if (g_flight.nsnaps >= CONFIG_PYXIS_SYSMON_FLIGHTREC_MAX) {
+    if (g_flight.nsnaps++ == CONFIG_PYXIS_SYSMON_FLIGHTREC_MAX) {
+      printf("System Monitor: %s, snapshot limit reached\n", reason);
+    }
+
+    return;
+  }
+
+  sysmon_flight_snapshot(reason);
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_FLIGHTREC */
+
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+
+/****************************************************************************
+ * Name: sysmon_selfstat_begin
+ ****************************************************************************/
+
+static void sysmon_selfstat_begin(FAR struct sysmon_collector_s* c)
+{
+  c->start = sysmon_clock();
+  c->startbytes = g_sysmon.nbytes;
+  c->startheap = mallinfo().uordblks;
+}
+
+/****************************************************************************
+ * Name: sysmon_selfstat_end
+ ****************************************************************************/
+
+static void sysmon_selfstat_end(FAR struct sysmon_collector_s* c)
+{
+  c->time += sysmon_clock() - c->start;
+  c->nbytes += g_sysmon.nbytes - c->startbytes;
+  c->heap += mallinfo().uordblks - c->startheap;
+  c->npasses++;
+}
+
+/****************************************************************************
+ * Name: sysmon_selfstat_emit
+ *
+ * Description:
+ *   Print the cost of each collector since the previous report, the share
+ *   of wall time spent sampling and the CPU share of the daemon itself.
+ *   HEAP is the change of the heap in use over the passes, from
+ *   mallinfo().  The bytes emitted by ps are not seen by sysmon.  The
+ *   report itself is accounted for in the next one.
+ *
+ ****************************************************************************/
+
+static int sysmon_selfstat_emit(FAR struct sysmon_collector_s* c)
+{
+  uint64_t now = sysmon_clock();
+  uint64_t wall = now - g_selfstart;
+  char load[16];
+  int busy = 0;
+
+  sysmon_printf("COLLECTOR    PASSES TIME(us)    BYTES   HEAP OVERRUNS\n");
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    FAR struct sysmon_collector_s* sc = &g_collectors[i];
+
+    if (!sc->enabled) {
+      continue;
+    }
+
+    sysmon_printf("%-12s %6u %8lu %8zu %6ld %8u\n", sc->name, sc->npasses,
+      (unsigned long)(sc->time / 1000), sc->nbytes, sc->heap,
+      sc->overruns);
+
+    sc->npasses = 0;
+    sc->time = 0;
+    sc->nbytes = 0;
+    sc->heap = 0;
+  }
+
+  if (g_selfstart != 0 && wall > 0) {
+    busy = g_selfbusy * 1000 / wall;
+  }
+
+  g_selfstart = now;
+  g_selfbusy = 0;
+
+  if (sysmon_read_node("self", "loadavg", load, sizeof(load)) < 0) {
+    strlcpy(load, "-", sizeof(load));
+  }
+
+  sysmon_printf("Sampling busy %d.%d%%, daemon CPU %s\n",
+    busy / 10, busy % 10, sysmon_isolate_value(load));
+  sysmon_printf("Steady state passes growing the heap %u, %ld bytes\n",
+    g_sysmon.nsteady, g_sysmon.steadybytes);
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  sysmon_printf("Output writes dropped %lu\n", sysmon_sink_drops());
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+  sysmon_printf("Remote samples dropped %lu\n", sysmon_remote_drops());
+#endif
+  return OK;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_SELFSTAT */
+
+/****************************************************************************
+ * Name: sysmon_init
+ ****************************************************************************/
+
+static void sysmon_init(void)
+{
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    g_tasks[i].pid = -1;
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+    g_stacks[i].pid = -1;
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+    g_crits[i].pid = -1;
+#endif
+  }
+
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    FAR struct sysmon_collector_s* c = &g_collectors[i];
+    int fd;
+
+    c->enabled = true;
+    c->stretch = 1;
+    if (c->budget == 0) {
+      c->budget = CONFIG_PYXIS_SYSMON_BUDGET;
+    }
+
+    if (c->node != NULL) {
+      if (c->path == NULL) {
+        asprintf(&c->path, "%s/%s", g_sysmon.root, c->node);
+      }
+
+      fd = c->path != NULL ? open(c->path, O_RDONLY) : -1;
+      c->enabled = fd >= 0;
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    if (c->enabled && c->init != NULL) {
+      c->enabled = c->init(c) >= 0;
+    }
+
+    printf(c->enabled ? "%s enabled\n" : "%s disabled\n", c->name);
+  }
+
+  notectlfd = open("/dev/notectl", 0);
+  if (notectlfd > 0) {
+    notectl.enabled = true;
+    notectl_enable(true, notectlfd);
+  }
+  printf(notectl.enabled ? "%s enabled\n" : "%s disabled\n", notectl.d_name);
+}
+
+/****************************************************************************
+ * Name: sysmon_deinit
+ ****************************************************************************/
+
+static void sysmon_deinit(void)
+{
+  if (notectlfd > 0) {
+    notectl_enable(false, notectlfd);
+    close(notectlfd);
+    notectlfd = -1;
+  }
+
+  notectl.enabled = false;
+}
+
+#ifndef CONFIG_NSH_DISABLE_PS
+
+/****************************************************************************
+ * Name: sysmon_ps_directory
+ ****************************************************************************/
+
+static int sysmon_ps_directory(FAR struct dirent* entryp)
+{
+  static FAR const char* const fields[] = {
+    "Priority:", "Scheduler:", "Type:", "State:", "Name:"
+  };
+
+  struct sysmon_file_s file;
+  char values[nitems(fields)][CONFIG_TASK_NAME_SIZE > 11 ?
+                              CONFIG_TASK_NAME_SIZE + 1 : 12];
+  char path[SYSMON_PATH_SIZE];
+  int ret;
+
+  snprintf(path, sizeof(path), "%s/%s/status", g_sysmon.root,
+    entryp->d_name);
+  ret = sysmon_fopen(&file, path);
+  if (ret < 0) {
+    return ret;
+  }
+
+  for (unsigned int i = 0; i < nitems(fields); i++) {
+    values[i][0] = '\0';
+  }
+
+  while (sysmon_fgets(g_sysmon.line, sizeof(g_sysmon.line), &file) != NULL) {
+    for (unsigned int i = 0; i < nitems(fields); i++) {
+      int len = strlen(fields[i]);
+
+      if (strncmp(g_sysmon.line, fields[i], len) == 0) {
+        strlcpy(values[i], sysmon_isolate_value(&g_sysmon.line[len]),
+          sizeof(values[i]));
+        break;
+      }
+    }
+  }
+
+  sysmon_fclose(&file);
+
+  /* SCHED_FIFO is printed as FIFO, like nsh does */
+
+  sysmon_printf("%5s %4s %-6s %-7s %-11s %s\n", entryp->d_name, values[0],
+    strncmp(values[1], "SCHED_", 6) == 0 ? values[1] + 6 : values[1],
+    values[2], values[3], values[4]);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_ps_emit
+ *
+ * Description:
+ *   List the tasks from their procfs status.  This used to run the nsh ps
+ *   command, which spawns a task on every pass.
+ *
+ ****************************************************************************/
+
+static int sysmon_ps_emit(FAR struct sysmon_collector_s* c)
+{
+  int ret;
+
+  sysmon_printf("PS INFO:\n");
+  sysmon_printf("---------------------------\n");
+  sysmon_printf("  PID  PRI POLICY TYPE    STATE       COMMAND\n");
+  ret = sysmon_foreach_task(sysmon_ps_directory);
+  sysmon_printf("---------------------------\n");
+  return ret;
+}
+
+#endif
+
+/****************************************************************************
+ * Name: sysmon_critmon_emit
+ ****************************************************************************/
+
+static int sysmon_critmon_emit(FAR struct sysmon_collector_s* c)
+{
+  int ret;
+
+  /* Output a Header */
+
+#if CONFIG_TASK_NAME_SIZE > 0
+  sysmon_printf("PRE-EMPTION CSECTION    PID   DESCRIPTION\n");
+#else
+  sysmon_printf("PRE-EMPTION CSECTION    PID\n");
+#endif
+  sysmon_printf("MAX DISABLE MAX TIME\n");
+
+  /* Should global usage first */
+
+  sysmon_global_crit();
+
+#ifdef CONFIG_PYXIS_SYSMON_STACK
+  /* Let the stack collector piggyback on this walk if it is due too */
+
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    FAR struct sysmon_collector_s* s = &g_collectors[i];
+
+    if (s->sample == sysmon_stack_sample) {
+      g_stackwalk = s->enabled && g_sysmon.now >= s->due;
+      break;
+    }
+  }
+
+  if (g_stackwalk) {
+    for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+      g_stacks[i].seen = false;
+    }
+  }
+#endif
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    g_crits[i].seen = false;
+  }
+#endif
+
+  ret = sysmon_foreach_task(sysmon_process_directory);
+
+#ifdef CONFIG_PYXIS_SYSMON_CRITDIST
+  sysmon_printf("\n");
+  sysmon_crit_emit();
+#endif
+
+  sysmon_printf("\n");
+  return ret;
+}
+
+#ifdef CONFIG_DRIVERS_NOTERAM
+
+/****************************************************************************
+ * Name: sysmon_trace_emit
+ ****************************************************************************/
+
+static int sysmon_trace_emit(FAR struct sysmon_collector_s* c)
+{
+  ssize_t nbytes;
+
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  /* The dump bypasses the line filter, let its headings through */
+
+  sysmon_delta_flush();
+#endif
+
+  nbytes = sysmon_trace_dump(stdout);
+  if (nbytes > 0) {
+    g_sysmon.nbytes += (size_t)nbytes;
+  }
+
+  sysmon_trace_dump_clear();
+  fflush(stdout);
+  return OK;
+}
+
+#endif
+
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+
+/****************************************************************************
+ * Name: sysmon_profile_collect
+ *
+ * Description:
+ *   Print the samples the profiler took since the last pass and append
+ *   their folded stacks to the profile file.
+ *
+ ****************************************************************************/
+
+static int sysmon_profile_collect(FAR struct sysmon_collector_s* c)
+{
+  /* Not sampling outside the daemon, e.g. for a one shot sysmon */
+
+  if (sysmon_profile_emit(sysmon_printf) == -EAGAIN) {
+    sysmon_printf("not running\n");
+  }
+
+  sysmon_printf("\n");
+  return OK;
+}
+
+#endif
+
+/****************************************************************************
+ * Name: sysmon_cpuload_sample
+ ****************************************************************************/
+
+static int sysmon_cpuload_sample(FAR struct sysmon_collector_s* c)
+{
+  char buffer[16];
+  int ret;
+
+  ret = sysmon_read_file(c->path, buffer, sizeof(buffer));
+  if (ret < 0) {
+    return ret;
+  }
+  for (int j = MAX_CPULOAD_HISTORY - 1; j; j--) {
+    clhistory[j] = clhistory[j-1];
+  }
+  ret = sscanf(buffer, "%d.%d%%", &clhistory[0], &clfraction);
+  return ret < 2 ? -EINVAL : OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_cpuload_emit
+ ****************************************************************************/
+
+static int sysmon_cpuload_emit(FAR struct sysmon_collector_s* c)
+{
+  sysmon_printf("CPU load: %d.%d%%\n", clhistory[0], clfraction);
+  sysmon_printf("#");
+  for (int j = 0; j < MAX_CPULOAD_HISTORY; j++) {
+    sysmon_printf("-");
+  }
+  sysmon_printf("#\n");
+  for (int k = 10; k >= 0; k--) {
+    sysmon_printf("|");
+    sysmon_printf("\x1B[35m");
+    for (int j = MAX_CPULOAD_HISTORY - 1; j>=0; j--) {
+      sysmon_printf(clhistory[j] >= k * 10 ? "*" : ".");
+    }
+    sysmon_printf("\x1B[0m");
+    sysmon_printf("|\n");
+  }
+  sysmon_printf("#");
+  for (int j = 0; j < MAX_CPULOAD_HISTORY; j++) {
+    sysmon_printf("-");
+  }
+  sysmon_printf("#\n");
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_cat_emit
+ *
+ * Description:
+ *   Copy the procfs node of the collector to the output as is.
+ *
+ ****************************************************************************/
+
+static int sysmon_cat_emit(FAR struct sysmon_collector_s* c)
+{
+  static char buffer[256];
+  int nbytesread;
+  int fd;
+
+  fd = open(c->path, O_RDONLY);
+  if (fd < 0) {
+    return -errno;
+  }
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  sysmon_delta_flush();
+#endif
+  for (;;) {
+    nbytesread = read(fd, buffer, sizeof(buffer));
+    if (nbytesread < 0) {
+      break;
+    } else if (nbytesread > 0) {
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+      g_sysmon.nbytes += sysmon_sink_write(buffer, nbytesread);
+#else
+      int nbyteswritten = 0;
+      while (nbyteswritten < nbytesread) {
+        ssize_t n = fwrite(buffer, sizeof(char), nbytesread, stdout);
+        if (n < 0) {
+          fprintf(stderr, "write to stdout error\n");
+          break;
+        } else {
+          nbyteswritten += n;
+          g_sysmon.nbytes += n;
+        }
+      }
+#endif
+    } else {
+      fflush(stdout);
+      break;
+    }
+  }
+
+  close(fd);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_slope
+ *
+ * Description:
+ *   Least squares slope of the last n values of a ring buffer, oldest
+ *   first, in units per sample.
+ *
+ ****************************************************************************/
+
+static long sysmon_slope(FAR const long* ring, unsigned int size,
+                         unsigned int head, unsigned int n)
+{
+  long long sx = 0;
+  long long sy = 0;
+  long long sxy = 0;
+  long long sxx = 0;
+  long long den;
+
+  for (unsigned int x = 0; x < n; x++) {
+    long long y = ring[(head + size - n + x) % size];
+
+    sx += x;
+    sy += y;
+    sxy += x * y;
+    sxx += x * x;
+  }
+
+  den = (long long)n * sxx - sx * sx;
+  return den != 0 ? (n * sxy - sx * sy) / den : 0;
+}
+
+/****************************************************************************
+ * Name: sysmon_meminfo_heap
+ ****************************************************************************/
+
+static FAR struct sysmon_heap_s* sysmon_meminfo_heap(FAR const char* name)
+{
+  for (int i = 0; i < g_nheaps; i++) {
+    if (strcmp(g_heaps[i].name, name) == 0) {
+      return &g_heaps[i];
+    }
+  }
+
+  if (g_nheaps >= CONFIG_PYXIS_SYSMON_MEMINFO_HEAPS) {
+    return NULL;
+  }
+
+  memset(&g_heaps[g_nheaps], 0, sizeof(g_heaps[0]));
+  strlcpy(g_heaps[g_nheaps].name, name, sizeof(g_heaps[0].name));
+  return &g_heaps[g_nheaps++];
+}
+
+/****************************************************************************
+ * Name: sysmon_meminfo_sample
+ *
+ * Description:
+ *   Parse /proc/meminfo into numbers.  The columns are located through the
+ *   header line, so both the older layout with a "Umem:" prefix and a
+ *   "largest" column and the newer one with "maxfree", "nfree" and a
+ *   trailing "name" column are understood.  Lines that do not match the
+ *   header are ignored.
+ *
+ ****************************************************************************/
+
+static int sysmon_meminfo_sample(FAR struct sysmon_collector_s* c)
+{
+  enum {
+    COL_TOTAL, COL_USED, COL_FREE, COL_LARGEST, COL_NFREE, COL_NAME, COLS
+  };
+
+  static FAR const char* const names[COLS] = {
+    "total", "used", "free", "largest", "nfree", "name"
+  };
+
+  FAR struct sysmon_heap_s* heap;
+  FAR char* tokens[12];
+  FAR char* saveptr;
+  int cols[COLS];
+  int ncols = 0;
+  char line[128];
+  struct sysmon_file_s file;
+  int ntokens;
+
+  if (sysmon_fopen(&file, c->path) < 0) {
+    return -errno;
+  }
+
+  for (int i = 0; i < COLS; i++) {
+    cols[i] = -1;
+  }
+
+  for (int i = 0; i < g_nheaps; i++) {
+    g_heaps[i].seen = false;
+  }
+
+  while (sysmon_fgets(line, sizeof(line), &file) != NULL) {
+    ntokens = 0;
+    for (FAR char* tok = strtok_r(line, " \t\n", &saveptr);
+         tok != NULL && ntokens < (int)nitems(tokens);
+         tok = strtok_r(NULL, " \t\n", &saveptr)) {
+      tokens[ntokens++] = tok;
+    }
+
+    if (ntokens == 0) {
+      continue;
+    } else if (ncols == 0) {
+      /* Header line */
+
+      for (int i = 0; i < ntokens; i++) {
+        for (int j = 0; j < COLS; j++) {
+          if (strcmp(tokens[i], names[j]) == 0 ||
+              (j == COL_LARGEST && strcmp(tokens[i], "maxfree") == 0)) {
+            cols[j] = i;
+          }
+        }
+      }
+
+      ncols = ntokens;
+      if (cols[COL_TOTAL] < 0 || cols[COL_USED] < 0 || cols[COL_FREE] < 0) {
+        break;
+      }
+
+      continue;
+    }
+
+    /* Older kernels prefix each line with "<name>:" which has no header */
+
+    if (tokens[0][strlen(tokens[0]) - 1] == ':') {
+      if (ntokens - 1 != ncols) {
+        continue;
+      }
+
+      tokens[0][strlen(tokens[0]) - 1] = '\0';
+      heap = sysmon_meminfo_heap(tokens[0]);
+      memmove(tokens, tokens + 1, --ntokens * sizeof(tokens[0]));
+    } else if (cols[COL_NAME] >= 0 && ntokens == ncols) {
+      heap = sysmon_meminfo_heap(tokens[cols[COL_NAME]]);
+    } else {
+      continue;
+    }
+
+    if (heap == NULL) {
+      continue;
+    }
+
+    heap->seen = true;
+    heap->total = atol(tokens[cols[COL_TOTAL]]);
+    heap->used = atol(tokens[cols[COL_USED]]);
+    heap->free = atol(tokens[cols[COL_FREE]]);
+    heap->largest = cols[COL_LARGEST] >= 0 ?
+                    atol(tokens[cols[COL_LARGEST]]) : -1;
+    heap->nfree = cols[COL_NFREE] >= 0 ? atoi(tokens[cols[COL_NFREE]]) : -1;
+
+    heap->usedhist[heap->head] = heap->used;
+    heap->fraghist[heap->head] = heap->largest >= 0 && heap->free > 0 ?
+                                 heap->largest * 1000 / heap->free : 1000;
+    heap->head = (heap->head + 1) % CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY;
+    if (heap->nsamples < CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY) {
+      heap->nsamples++;
+    }
+  }
+
+  sysmon_fclose(&file);
+  return ncols > 0 ? OK : -EINVAL;
+}
+
+/****************************************************************************
+ * Name: sysmon_meminfo_emit
+ *
+ * Description:
+ *   Print the numbers of each heap with its fragmentation and trend.  The
+ *   used memory of a heap that rose in at least 3/4 of the steps of a full
+ *   history, with a slope of at least MEMINFO_LEAK_SLOPE bytes per sample,
+ *   is reported as a possible leak.  Falls back to the raw node if nothing
+ *   could be parsed.
+ *
+ ****************************************************************************/
+
+static int sysmon_meminfo_emit(FAR struct sysmon_collector_s* c)
+{
+  const unsigned int size = CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY;
+  long frag[CONFIG_PYXIS_SYSMON_MEMINFO_HISTORY];
+  FAR struct sysmon_heap_s* heap;
+  bool header = false;
+  char trend[16];
+  long slope;
+  int rises;
+
+  for (int i = 0; i < g_nheaps; i++) {
+    heap = &g_heaps[i];
+    if (!heap->seen) {
+      continue;
+    }
+
+    if (!header) {
+      sysmon_printf("HEAP           TOTAL       USED       FREE    LARGEST "
+        "NFREE  RATIO   TREND\n");
+      header = true;
+    }
+
+    for (unsigned int j = 0; j < size; j++) {
+      frag[j] = heap->fraghist[j];
+    }
 
-/****************************************************************************
- * Private Data
- ****************************************************************************/
+    /* The sign goes apart, slope / 10 loses it between -9 and -1 */
 
-static struct sysmon_state_s g_sysmon;
-static enum feature_s {
-  CRITMON,
-  IRQS,
-  CPULOAD,
-  MEMINFO,
-  IOBINFO,
-  FEATURES
-};
-static struct sysmon_feature_s feature[] = {
-  { .d_name = "critmon", .path = NULL, .enabled = false },
-  { .d_name = "irqs", .path = NULL, .enabled = false },
-  { .d_name = "cpuload", .path = NULL, .enabled = false },
-  { .d_name = "meminfo", .path = NULL, .enabled = false },
-  { .d_name = "iobinfo", .path = NULL, .enabled = false },
-};
-static struct sysmon_feature_s notectl = {
-  .d_name = "/dev/notectl", .path = NULL, .enabled = false
-};
-static int notectlfd = 0;
-#if CONFIG_TASK_NAME_SIZE > 0
-static const char g_name[] = "Name:";
-#endif
+    slope = sysmon_slope(frag, size, heap->head, heap->nsamples);
+    snprintf(trend, sizeof(trend), "%c%ld.%ld", slope < 0 ? '-' : '+',
+      labs(slope) / 10, labs(slope) % 10);
+    sysmon_printf("%-10s %10ld %10ld %10ld %10ld %5d %3ld.%ld%% %7s\n",
+      heap->name, heap->total, heap->used, heap->free, heap->largest,
+      heap->nfree, frag[(heap->head + size - 1) % size] / 10,
+      frag[(heap->head + size - 1) % size] % 10, trend);
 
-static int clhistory[MAX_CPULOAD_HISTORY];
+    if (heap->nsamples < size) {
+      continue;
+    }
 
-/****************************************************************************
- * Private Functions
- ****************************************************************************/
+    rises = 0;
+    for (unsigned int j = 1; j < size; j++) {
+      if (heap->usedhist[(heap->head + j) % size] >
+          heap->usedhist[(heap->head + j - 1) % size]) {
+        rises++;
+      }
+    }
+
+    slope = sysmon_slope(heap->usedhist, size, heap->head, size);
+    if (rises * 4 >= (size - 1) * 3 &&
+        slope >= CONFIG_PYXIS_SYSMON_MEMINFO_LEAK_SLOPE) {
+      sysmon_printf("Possible leak in %s: used +%ld bytes/sample over %u "
+        "samples\n", heap->name, slope, size);
+    }
+  }
+
+  return header ? OK : sysmon_cat_emit(c);
+}
 
 /****************************************************************************
- * Name: notectl_enable
+ * Name: sysmon_irqs_sample
+ *
+ * Description:
+ *   Parse /proc/irqs into per-IRQ cumulative counts and derive the rate
+ *   of each IRQ since the previous sample.  The IRQ, COUNT and optional
+ *   TIME columns are located through the header line.  An IRQ is marked
+ *   as storming when its rate exceeds IRQS_STORM_FACTOR times its moving
+ *   average and IRQS_STORM_MIN per second.
+ *
  ****************************************************************************/
 
-static bool notectl_enable(int flag, int notectlfd)
+static int sysmon_irqs_sample(FAR struct sysmon_collector_s* c)
 {
-#ifdef CONFIG_DRIVERS_NOTECTL
-  struct note_filter_mode_s mode;
-  int oldflag;
+  FAR struct sysmon_irq_s* irq;
+  uint64_t now = sysmon_clock();
+  uint64_t elapsed = now - g_irqstime;
+  FAR char* tokens[8];
+  FAR char* saveptr;
+  int colirq = -1;
+  int colcount = -1;
+  int coltime = -1;
+  int ncols = 0;
+  char line[128];
+  struct sysmon_file_s file;
+  int ntokens;
+  int i;
 
-  ioctl(notectlfd, NOTECTL_GETMODE, (unsigned long)&mode);
+  if (sysmon_fopen(&file, c->path) < 0) {
+    return -errno;
+  }
 
-  oldflag = (mode.flag & NOTE_FILTER_MODE_FLAG_ENABLE) != 0;
-  if (flag == oldflag)
-    {
-      /* Already set */
+  for (i = 0; i < g_nirqs; i++) {
+    g_irqs[i].seen = false;
+  }
 
-      return false;
+  while (sysmon_fgets(line, sizeof(line), &file) != NULL) {
+    ntokens = 0;
+    for (FAR char* tok = strtok_r(line, " \t\n", &saveptr);
+         tok != NULL && ntokens < (int)nitems(tokens);
+         tok = strtok_r(NULL, " \t\n", &saveptr)) {
+      tokens[ntokens++] = tok;
     }
 
-  if (flag)
-    {
-      mode.flag |= NOTE_FILTER_MODE_FLAG_ENABLE;
+    if (ntokens == 0) {
+      continue;
+    } else if (ncols == 0) {
+      for (i = 0; i < ntokens; i++) {
+        if (strcmp(tokens[i], "IRQ") == 0) {
+          colirq = i;
+        } else if (strcmp(tokens[i], "COUNT") == 0) {
+          colcount = i;
+        } else if (strncmp(tokens[i], "TIME", 4) == 0) {
+          coltime = i;
+        }
+      }
+
+      ncols = ntokens;
+      if (colirq < 0 || colcount < 0) {
+        break;
+      }
+
+      continue;
+    } else if (ntokens != ncols) {
+      continue;
     }
-  else
-    {
-      mode.flag &= ~NOTE_FILTER_MODE_FLAG_ENABLE;
+
+    for (i = 0; i < g_nirqs; i++) {
+      if (g_irqs[i].irq == atoi(tokens[colirq])) {
+        break;
+      }
     }
 
-  ioctl(notectlfd, NOTECTL_SETMODE, (unsigned long)&mode);
-#endif
-  return true;
+    irq = &g_irqs[i];
+    if (i == g_nirqs) {
+      if (g_nirqs >= CONFIG_PYXIS_SYSMON_IRQS_MAX) {
+        continue;
+      }
+
+      memset(irq, 0, sizeof(*irq));
+      irq->irq = atoi(tokens[colirq]);
+      irq->count = strtoul(tokens[colcount], NULL, 10);
+      g_nirqs++;
+    }
+
+    irq->seen = true;
+    irq->delta = strtoul(tokens[colcount], NULL, 10) - irq->count;
+    irq->count += irq->delta;
+    irq->time = coltime >= 0 ? atol(tokens[coltime]) : -1;
+
+    if (g_irqstime == 0 || elapsed == 0) {
+      continue;
+    }
+
+    irq->rate = irq->delta * NSEC_PER_SEC / elapsed;
+    irq->storm = irq->average > 0 &&
+                 irq->rate >= CONFIG_PYXIS_SYSMON_IRQS_STORM_MIN &&
+                 irq->rate * 16 >
+                 irq->average * CONFIG_PYXIS_SYSMON_IRQS_STORM_FACTOR;
+
+    /* Exponential moving average over about eight samples */
+
+    if (irq->average == 0) {
+      irq->average = irq->rate * 16;
+    } else {
+      irq->average = irq->average - irq->average / 8 + irq->rate * 2;
+    }
+  }
+
+  sysmon_fclose(&file);
+  g_irqstime = now;
+  return ncols > 0 ? OK : -EINVAL;
 }
 
 /****************************************************************************
- * Name: sysmon_isolate_value
+ * Name: sysmon_irqs_compare
  ****************************************************************************/
 
-static FAR char* sysmon_isolate_value(FAR char* line)
+static int sysmon_irqs_compare(FAR const void* a, FAR const void* b)
 {
-  FAR char* ptr;
+  FAR const struct sysmon_irq_s* ia = *(FAR struct sysmon_irq_s* const*)a;
+  FAR const struct sysmon_irq_s* ib = *(FAR struct sysmon_irq_s* const*)b;
 
-  while (isblank(*line) && *line != '\0') {
-    line++;
+  return ia->delta < ib->delta ? 1 : ia->delta > ib->delta ? -1 : 0;
+}
+
+/****************************************************************************
+ * Name: sysmon_irqs_emit
+ *
+ * Description:
+ *   Print the IRQS_NTOP busiest IRQs of the last interval.  Storming IRQs
+ *   are always printed.  Falls back to the raw node if nothing could be
+ *   parsed.
+ *
+ ****************************************************************************/
+
+static int sysmon_irqs_emit(FAR struct sysmon_collector_s* c)
+{
+  FAR struct sysmon_irq_s* list[CONFIG_PYXIS_SYSMON_IRQS_MAX];
+  int nirqs = 0;
+
+  for (int i = 0; i < g_nirqs; i++) {
+    if (g_irqs[i].seen) {
+      list[nirqs++] = &g_irqs[i];
+    }
   }
 
-  ptr = line;
-  while (*ptr != '\n' && *ptr != '\r' && *ptr != '\0') {
-    ptr++;
+  if (nirqs == 0) {
+    return sysmon_cat_emit(c);
   }
 
-  *ptr = '\0';
-  return line;
+  qsort(list, nirqs, sizeof(list[0]), sysmon_irqs_compare);
+
+  sysmon_printf("IRQ      COUNT    DELTA   RATE/s   TIME\n");
+  for (int i = 0; i < nirqs; i++) {
+    FAR struct sysmon_irq_s* irq = list[i];
+
+    if (i >= CONFIG_PYXIS_SYSMON_IRQS_NTOP && !irq->storm) {
+      continue;
+    }
+
+    sysmon_printf("%3d %10lu %8lu %8lu %6ld%s\n", irq->irq, irq->count,
+      irq->delta, irq->rate, irq->time,
+      irq->storm ? " storm" : "");
+  }
+
+  return OK;
 }
 
 /****************************************************************************
- * Name: sysmon_process_directory
+ * Name: sysmon_iob_sample
  ****************************************************************************/
 
-static int sysmon_process_directory(FAR struct dirent* entryp)
+static int sysmon_iob_sample(FAR struct sysmon_collector_s* c)
 {
-  FAR const char* tmpstr;
-  FAR char* filepath;
-  FAR char* maxpreemp;
-  FAR char* maxcrit;
-  FAR char* endptr;
-  FILE* stream;
-  int errcode;
-  int len;
+  char buffer[128];
   int ret;
 
-#if CONFIG_TASK_NAME_SIZE > 0
-  FAR char* name = NULL;
+  ret = sysmon_read_file(c->path, buffer, sizeof(buffer));
+  if (ret < 0) {
+    return ret;
+  }
 
-  /* Read the task status to get the task name */
+  g_iobprev = g_iob;
+  if (!sysmon_parse_iobinfo(buffer, &g_iob)) {
+    g_iobvalid = false;
+    return OK;
+  }
 
-  filepath = NULL;
-  ret = asprintf(&filepath, CONFIG_PYXIS_SYSMON_MOUNTPOINT "/%s/status",
-    entryp->d_name);
-  if (ret < 0 || filepath == NULL) {
-    errcode = errno;
-    fprintf(stderr, "System Monitor: Failed to create path to status file: %d\n",
-      errcode);
-    return -errcode;
+  if (!g_iobvalid) {
+    g_iobprev = g_iob;
+    g_iobvalid = true;
   }
 
-  /* Open the status file */
+  return OK;
+}
 
-  stream = fopen(filepath, "r");
-  if (stream == NULL) {
-    ret = -errno;
-    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
-      filepath, ret);
-    goto errout_with_filepath;
+/****************************************************************************
+ * Name: sysmon_iob_emit
+ *
+ * Description:
+ *   Print the IOB counters with the change of the wait and throttle
+ *   counters since the previous sample and the lowest free count seen so
+ *   far, including the ones caught by the adaptive probe.
+ *
+ ****************************************************************************/
+
+static int sysmon_iob_emit(FAR struct sysmon_collector_s* c)
+{
+  if (!g_iobvalid) {
+    return sysmon_cat_emit(c);
   }
 
-  while (fgets(g_sysmon.line, 80, stream) != NULL) {
-    g_sysmon.line[79] = '\n';
-    len = strlen(g_name);
-    if (strncmp(g_sysmon.line, g_name, len) == 0) {
-      tmpstr = sysmon_isolate_value(&g_sysmon.line[len]);
-      if (*tmpstr == '\0') {
-        ret = -EINVAL;
-        goto errout_with_stream;
-      }
+  sysmon_printf("TOTAL  FREE   MIN   WAIT (+/-) THROTTLE (+/-)\n");
+  sysmon_printf("%5d %5d %5d %6d %+5d %8d %+5d\n", g_iob.ntotal,
+    g_iob.nfree, g_iobmin, g_iob.nwait, g_iob.nwait - g_iobprev.nwait,
+    g_iob.nthrottle, g_iob.nthrottle - g_iobprev.nthrottle);
 
-      name = strdup(tmpstr);
-      if (name == NULL) {
-        ret = -EINVAL;
-        goto errout_with_stream;
-      }
-    }
+  if (CONFIG_PYXIS_SYSMON_IOB_WATERMARK > 0 &&
+      g_iob.nfree < CONFIG_PYXIS_SYSMON_IOB_WATERMARK) {
+    sysmon_printf("IOB pool low: %d free, watermark %d\n", g_iob.nfree,
+      CONFIG_PYXIS_SYSMON_IOB_WATERMARK);
   }
 
-  free(filepath);
-  fclose(stream);
-#endif
+  return OK;
+}
 
-  /* Read critical section information */
+/****************************************************************************
+ * Name: sysmon_collect
+ *
+ * Description:
+ *   Run one pass of a collector and schedule its next one.  A pass that
+ *   goes over the cost budget doubles the period of the collector, up to
+ *   SYSMON_MAX_STRETCH times the configured one; passes within budget
+ *   shrink it back.
+ *
+ ****************************************************************************/
 
-  filepath = NULL;
+static int sysmon_collect(FAR struct sysmon_collector_s* c, uint64_t now)
+{
+  uint64_t start = sysmon_clock();
+  uint64_t cost;
+  int ret = OK;
 
-  ret = asprintf(&filepath, CONFIG_PYXIS_SYSMON_MOUNTPOINT "/%s/critmon",
-    entryp->d_name);
-  if (ret < 0 || filepath == NULL) {
-    errcode = errno;
-    fprintf(stderr, "System Monitor: Failed to create path to Csection file: %d\n",
-      errcode);
-    ret = -EINVAL;
-    goto errout_with_name;
+  sysmon_stat_begin(c);
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  sysmon_delta_begin(c);
+#endif
+  if (c->sample != NULL) {
+    ret = c->sample(c);
   }
 
-  /* Open the Csection file */
+  if (ret >= 0 && c->emit != NULL) {
+    if (c->title != NULL) {
+      sysmon_printf("%s", c->title);
+    }
 
-  stream = fopen(filepath, "r");
-  if (stream == NULL) {
-    ret = -errno;
-    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
-      filepath, ret);
-    goto errout_with_filepath;
+    ret = c->emit(c);
   }
 
-  /* Read the line containing the Csection max durations */
+  sysmon_stat_end(c);
 
-  if (fgets(g_sysmon.line, 80, stream) == NULL) {
-    ret = -errno;
-    fprintf(stderr, "System Monitor: Failed to read from %s: %d\n",
-      filepath, ret);
-    goto errout_with_filepath;
+  cost = (sysmon_clock() - start) / 1000;
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  g_selfbusy += cost * 1000;
+#endif
+  if (c->budget > 0 && cost > c->budget) {
+    c->overruns++;
+    if (c->stretch < SYSMON_MAX_STRETCH) {
+      c->stretch *= 2;
+      fprintf(stderr, "System Monitor: %s over budget (%luus), period %ums\n",
+        c->name, (unsigned long)cost, SYSMON_PERIOD(c) * c->stretch);
+    }
+  } else if (c->stretch > 1) {
+    c->stretch /= 2;
   }
 
-  /* Input Format:   X.XXXXXXXXX,X.XXXXXXXXX
-  * Output Format:  X.XXXXXXXXX X.XXXXXXXXX NNNNN <name>
-  */
-
-  maxpreemp = g_sysmon.line;
-  maxcrit = strchr(g_sysmon.line, ',');
+  c->due = now + (uint64_t)SYSMON_PERIOD(c) * c->stretch * NSEC_PER_MSEC;
 
-  if (maxcrit != NULL) {
-    *maxcrit++ = '\0';
-    endptr = strchr(maxcrit, '\n');
-    if (endptr != NULL) {
-      *endptr = '\0';
+  if (ret < 0) {
+    if (++c->nerrors >= SYSMON_MAX_ERRORS) {
+      fprintf(stderr, "System Monitor: %s failed %u times, disabled\n",
+        c->name, c->nerrors);
+      c->enabled = false;
     }
   } else {
-    maxcrit = "None";
+    c->nerrors = 0;
   }
 
-  /* Finally, output the stack info that we gleaned from the procfs */
+  return ret;
+}
 
-#if CONFIG_TASK_NAME_SIZE > 0
-  printf("%11s %11s %5s %s\n",
-    maxpreemp, maxcrit, entryp->d_name, name);
+/****************************************************************************
+ * Name: sysmon_list_once
+ *
+ * Description:
+ *   Run the collectors whose period has elapsed at now, or all of them if
+ *   force is set.
+ *
+ ****************************************************************************/
+
+static int sysmon_list_once(uint64_t now, bool force)
+{
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  struct mallinfo mem = mallinfo();
+#endif
+  int exitcode = EXIT_SUCCESS;
+  bool header = false;
+
+  g_sysmon.now = now;
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  g_delta.active = true;
+  g_delta.keyframe = force ||
+    g_delta.npasses++ % CONFIG_PYXIS_SYSMON_DELTA_KEYFRAME == 0;
+  g_delta.collector = -1;
+  g_delta.npending = 0;
+  g_delta.npasspending = 0;
+#endif
+
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    FAR struct sysmon_collector_s* c = &g_collectors[i];
+
+    if (!c->enabled || (!force && now < c->due)) {
+      continue;
+    }
+
+    if (!header) {
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+      sysmon_printf(g_delta.keyframe ?
+                    "========================================\n" :
+                    "---------------- delta -----------------\n");
 #else
-  printf("%11s %11s %5s\n",
-    maxpreemp, maxcrit, entryp->d_name);
+      sysmon_printf("========================================\n");
 #endif
+      header = true;
+    }
 
-  ret = OK;
+    if (sysmon_collect(c, now) < 0) {
+      exitcode = EXIT_FAILURE;
+    }
+  }
 
-errout_with_stream:
-  fclose(stream);
+#ifdef CONFIG_PYXIS_SYSMON_SELFSTAT
+  /* The heap is measured rather than the call sites counted, so what libc
+   * allocates on our behalf is seen too.  The heap is shared, allocations
+   * of other tasks during the pass show up as well.  The first pass fills
+   * the tables and is left out.
+   */
 
-errout_with_filepath:
-  free(filepath);
+  if (g_sysmon.npasses++ > 0) {
+    struct mallinfo after = mallinfo();
 
-errout_with_name:
-#if CONFIG_TASK_NAME_SIZE > 0
-  if (name != NULL) {
-    free(name);
+    if (after.aordblks > mem.aordblks || after.uordblks > mem.uordblks) {
+      g_sysmon.nsteady++;
+      g_sysmon.steadybytes += after.uordblks - mem.uordblks;
+    }
   }
 #endif
 
-  return ret;
+#ifdef CONFIG_PYXIS_SYSMON_DELTA
+  g_delta.active = false;
+  if (g_delta.len > 0) {
+    sysmon_write(g_delta.line, g_delta.len);
+    g_delta.len = 0;
+  }
+#endif
+
+  return exitcode;
 }
 
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+
 /****************************************************************************
- * Name: sysmon_check_name
+ * Name: sysmon_snapshot_open
+ *
+ * Description:
+ *   Create the shared memory object the other apps read with
+ *   sysmon_snapshot_map().
+ *
  ****************************************************************************/
 
-static bool sysmon_check_name(FAR char* name)
+static void sysmon_snapshot_open(void)
 {
-  int i;
+  FAR void* addr;
+  int fd;
 
-  /* Check each character in the name */
+  fd = shm_open(SYSMON_SNAPSHOT_NAME, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    fprintf(stderr, "System Monitor: Failed to create snapshot: %d\n",
+      errno);
+    return;
+  }
 
-  for (i = 0; i < NAME_MAX && name[i] != '\0'; i++) {
-    if (!isdigit(name[i])) {
-      /* Name contains something other than a decimal numeric character */
+  if (ftruncate(fd, sizeof(*g_snapshot)) < 0) {
+    fprintf(stderr, "System Monitor: Failed to size snapshot: %d\n",
+      errno);
+    close(fd);
+    return;
+  }
 
-        return false;
-    }
+  addr = mmap(NULL, sizeof(*g_snapshot), PROT_READ | PROT_WRITE,
+    MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    fprintf(stderr, "System Monitor: Failed to map snapshot: %d\n", errno);
+    return;
   }
 
-  return true;
+  g_snapshot = addr;
+  g_snapshot->size = sizeof(*g_snapshot);
+  g_snapshot->version = SYSMON_SNAPSHOT_VERSION;
+  g_snapshot->magic = SYSMON_SNAPSHOT_MAGIC;
 }
 
 /****************************************************************************
- * Name: sysmon_global_crit
+ * Name: sysmon_snapshot_publish
+ *
+ * Description:
+ *   Update the snapshot with the latest numbers of the collectors.  The
+ *   sequence count is odd during the update so readers retry.
+ *
  ****************************************************************************/
 
-static void sysmon_global_crit(void)
+static void sysmon_snapshot_publish(uint32_t flags)
 {
-  FAR char* filepath;
-  FAR char* cpu;
-  FAR char* maxpreemp;
-  FAR char* maxcrit;
-  FAR char* endptr;
-  FILE* stream;
-  int errcode;
-  int ret;
-
-  /* Read critical section information */
-
-  filepath = NULL;
+  FAR struct sysmon_snapshot_s* snap = g_snapshot;
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+  FAR struct sysmon_task_s* top[CONFIG_PYXIS_SYSMON_MAX_TASKS];
+  int ntasks = 0;
+#endif
+  struct mallinfo mem;
+  uint32_t seq;
 
-  ret = asprintf(&filepath, CONFIG_PYXIS_SYSMON_MOUNTPOINT "/critmon");
-  if (ret < 0 || filepath == NULL) {
-    errcode = errno;
-    fprintf(stderr, "System Monitor: Failed to create path to Csection file: %d\n",
-      errcode);
+  if (snap == NULL) {
     return;
   }
 
-  /* Open the Csection file */
+  /* Gather everything first to keep the update window short */
 
-  stream = fopen(filepath, "r");
-  if (stream == NULL) {
-    errcode = errno;
-    fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
-      filepath, errcode);
-    goto errout_with_filepath;
+  mem = mallinfo();
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+  for (int i = 0; i < CONFIG_PYXIS_SYSMON_MAX_TASKS; i++) {
+    if (g_tasks[i].pid >= NCPUS) {
+      top[ntasks++] = &g_tasks[i];
+    }
   }
 
-  /* Read the line containing the Csection max durations for each CPU */
-
-  while (fgets(g_sysmon.line, 80, stream) != NULL) {
-    /* Input Format:  X,X.XXXXXXXXX,X.XXXXXXXXX
-    * Output Format: X.XXXXXXXXX X.XXXXXXXXX       CPU X
-    */
+  qsort(top, ntasks, sizeof(top[0]), sysmon_load_compare);
+  if (ntasks > SYSMON_SNAPSHOT_NTOP) {
+    ntasks = SYSMON_SNAPSHOT_NTOP;
+  }
+#endif
 
-    cpu = g_sysmon.line;
-    maxpreemp = strchr(g_sysmon.line, ',');
-
-    if (maxpreemp != NULL) {
-      *maxpreemp++ = '\0';
-      maxcrit = strchr(maxpreemp, ',');
-      if (maxcrit != NULL) {
-        *maxcrit++ = '\0';
-        endptr = strchr(maxcrit, '\n');
-        if (endptr != NULL) {
-          *endptr = '\0';
-        }
-      } else {
-        maxcrit = "None";
-      }
-    } else {
-      maxpreemp = "None";
-      maxcrit = "None";
-    }
+  seq = snap->seq;
+  __atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  snap->flags = flags;
+  snap->time = sysmon_clock();
+  snap->cpuload = clhistory[0] >= 0 ? clhistory[0] * 10 + clfraction : -1;
+  snap->iobfree = g_iobvalid ? g_iob.nfree : -1;
+  snap->memtotal = mem.arena;
+  snap->memfree = mem.fordblks;
+  snap->memlargest = mem.mxordblk;
+  snap->ntop = 0;
+#ifdef CONFIG_PYXIS_SYSMON_TOPLOAD
+  for (int i = 0; i < ntasks; i++) {
+    snap->top[i].pid = top[i]->pid;
+    snap->top[i].load = top[i]->load;
+#if CONFIG_TASK_NAME_SIZE > 0
+    strlcpy(snap->top[i].name, top[i]->name, sizeof(snap->top[i].name));
+#else
+    snap->top[i].name[0] = '\0';
+#endif
+  }
 
-    /* Finally, output the stack info that we gleaned from the procfs */
+  snap->ntop = ntasks;
+#endif
 
-    printf("%11s %11s  ---  CPU %s\n", maxpreemp, maxcrit, cpu);
-  }
+  __atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
+}
 
-  fclose(stream);
+/****************************************************************************
+ * Name: sysmon_snapshot_close
+ *
+ * Description:
+ *   Mark the snapshot stale for the readers that still map it and remove
+ *   the name so no new reader finds it.
+ *
+ ****************************************************************************/
 
-errout_with_filepath:
-  free(filepath);
+static void sysmon_snapshot_close(void)
+{
+  if (g_snapshot != NULL) {
+    sysmon_snapshot_publish(0);
+    munmap(g_snapshot, sizeof(*g_snapshot));
+    g_snapshot = NULL;
+    shm_unlink(SYSMON_SNAPSHOT_NAME);
+  }
 }
 
+#endif /* CONFIG_PYXIS_SYSMON_SNAPSHOT */
+
 /****************************************************************************
- * Name: sysmon_init
+ * Name: sysmon_next_due
+ *
+ * Description:
+ *   Return the time of the next collector pass.
+ *
  ****************************************************************************/
 
-static void sysmon_init(void)
+static uint64_t sysmon_next_due(void)
 {
-  for (int i = 0; i < FEATURES; i++) {
-    asprintf(&feature[i].path, CONFIG_PYXIS_SYSMON_MOUNTPOINT "/%s",
-      feature[i].d_name);
-    feature[i].enabled = !!fopen(feature[i].path, "r");
-    printf(feature[i].enabled ? "%s/%s enabled\n" : "%s/%s disabled\n",
-      CONFIG_PYXIS_SYSMON_MOUNTPOINT, feature[i].d_name);
-  }
+  uint64_t due = UINT64_MAX;
 
-  notectlfd = open("/dev/notectl", 0);
-  if (notectlfd > 0) {
-    notectl.enabled = true;
-    notectl_enable(true, notectlfd);
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    if (g_collectors[i].enabled && g_collectors[i].due < due) {
+      due = g_collectors[i].due;
+    }
   }
-  printf(notectl.enabled ? "%s enabled\n" : "%s disabled\n", notectl.d_name);
+
+  return due;
 }
 
 /****************************************************************************
- * Name: sysmon_deinit
+ * Name: sysmon_wait
+ *
+ * Description:
+ *   Sleep until the monotonic deadline in ns or until sysmon_ctl posts a
+ *   command.
+ *
  ****************************************************************************/
 
-static void sysmon_deinit(void)
+static void sysmon_wait(uint64_t deadline)
 {
-  if (notectlfd > 0) {
-    notectl_enable(false, notectlfd);
-    close(notectlfd);
+  struct timespec ts;
+
+  ts.tv_sec = deadline / NSEC_PER_SEC;
+  ts.tv_nsec = deadline % NSEC_PER_SEC;
+  while (sem_clockwait(&g_sysmon.wake, CLOCK_MONOTONIC, &ts) < 0 &&
+         errno == EINTR) {
   }
 }
 
 /****************************************************************************
- * Name: sysmon_list_once
+ * Name: sysmon_daemon
  ****************************************************************************/
 
-static int sysmon_list_once(bool graph)
+static int sysmon_daemon(int argc, char** argv)
 {
-  int fd;
-  FAR char* buffer;
-  int nbytesread;
-  DIR* dirp;
-  int exitcode = EXIT_SUCCESS;
-  int errcount = 0;
-  int cl;
-  int ret;
-
-  printf("========================================\n");
+  uint64_t now;
+  uint64_t wake;
+#ifdef SYSMON_HAVE_PROBE
+  struct sysmon_sample_s sample;
+  uint64_t nextprobe;
+#endif
 
-  #ifndef CONFIG_NSH_DISABLE_PS
-    printf("PS INFO:\n");
-    printf("---------------------------\n");
-    system("ps");
-    printf("---------------------------\n");
-  #endif
+  printf("System Monitor: Running: %d\n", g_sysmon.pid);
+  memset(clhistory, -1, sizeof(clhistory));
 
-  for (int i = 0; i < FEATURES; i++) {
-    if (feature[i].enabled) {
-      switch (i) {
-        case CRITMON:
-        /* Output a Header */
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  /* From here on the output is queued for the sink writer task */
 
-#if CONFIG_TASK_NAME_SIZE > 0
-          printf("PRE-EMPTION CSECTION    PID   DESCRIPTION\n");
-#else
-          printf("PRE-EMPTION CSECTION    PID\n");
+  fflush(stdout);
+  if (sysmon_sink_start() < 0) {
+    fprintf(stderr, "System Monitor: Failed to start the sink, "
+      "writing to stdout\n");
+  }
 #endif
-          printf("MAX DISABLE MAX TIME\n");
 
-          /* Should global usage first */
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+  sysmon_snapshot_open();
+#endif
 
-          sysmon_global_crit();
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+  if (sysmon_remote_start() < 0) {
+    fprintf(stderr, "System Monitor: Failed to start the remote link\n");
+  }
+#endif
 
-          /* Open the top-level procfs directory */
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+  if (sysmon_profile_start() < 0) {
+    fprintf(stderr, "System Monitor: Failed to start the profiler\n");
+  }
+#endif
 
-          dirp = opendir(CONFIG_PYXIS_SYSMON_MOUNTPOINT);
-          if (dirp == NULL) {
-            /* Failed to open the directory */
+  /* The first pass of every collector comes one period after start */
 
-            fprintf(stderr, "System Monitor: Failed to open directory: %s\n",
-              CONFIG_PYXIS_SYSMON_MOUNTPOINT);
+  now = sysmon_clock();
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    g_collectors[i].due = now + SYSMON_PERIOD(&g_collectors[i]) *
+                          NSEC_PER_MSEC;
+  }
 
-            if (++errcount > 100) {
-              fprintf(stderr, "System Monitor: Too many errors ... exiting\n");
-              exitcode = EXIT_FAILURE;
-              break;
-            }
-          }
+#ifdef CONFIG_PYXIS_SYSMON_ADAPTIVE
+  g_sysmon.period = SYSMON_IDLE_PERIOD;
+  g_sysmon.calm = 0;
+#endif
+#ifdef SYSMON_HAVE_PROBE
+  nextprobe = now + SYSMON_IDLE_PERIOD * NSEC_PER_MSEC;
+#endif
 
-          /* Read each directory entry */
+  /* Loop until we detect that there is a request to stop. */
 
-          for (;;) {
-            FAR struct dirent* entryp = readdir(dirp);
-            if (entryp == NULL) {
-              /* Finished with this directory */
+  while (!g_sysmon.stop) {
+    /* Wait for the next collector or probe to become due */
 
-                break;
-            }
+    wake = sysmon_next_due();
+#ifdef SYSMON_HAVE_PROBE
+    if (nextprobe < wake) {
+      wake = nextprobe;
+    }
+#endif
 
-          /* Task/thread entries in the /proc directory will all be (1)
-            * directories with (2) all numeric names.
-            */
+    if (notectl.enabled)
+      notectl_enable(true, notectlfd);
+    now = sysmon_clock();
+    if (wake == UINT64_MAX) {
+      wake = now + SYSMON_IDLE_PERIOD * NSEC_PER_MSEC;
+    }
 
-            if (DIRENT_ISDIRECTORY(entryp->d_type) && sysmon_check_name(entryp->d_name)) {
-              /* Looks good -- process the directory */
+    if (wake > now) {
+      sysmon_wait(wake);
+    }
 
-              ret = sysmon_process_directory(entryp);
-              if (ret < 0) {
-                /* Failed to process the thread directory */
+    if (g_sysmon.stop) {
+      break;
+    }
 
-                fprintf(stderr, "System Monitor: Failed to process sub-directory: %s\n",
-                  entryp->d_name);
+    now = sysmon_clock();
 
-                if (++errcount > 100) {
-                  fprintf(stderr, "System Monitor: Too many errors ... exiting\n");
-                  exitcode = EXIT_FAILURE;
-                  break;
-                }
-              }
-            }
-          }
+    /* Apply the commands of sysmon_ctl */
 
-          closedir(dirp);
-          fputc('\n', stdout);
+    if (g_sysmon.newinterval != 0) {
+      g_sysmon.interval = g_sysmon.newinterval;
+      g_sysmon.newinterval = 0;
+      for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+        if (g_collectors[i].period == 0) {
+          g_collectors[i].due = now + SYSMON_PERIOD(&g_collectors[i]) *
+                                NSEC_PER_MSEC;
+        }
+      }
 
-          printf("Processes switch info:\n");
-          printf("[CPU] Time:   Prev_task-PID State ==> Next_task-PID\n");
-          sysmon_trace_dump(stdout);
-          sysmon_trace_dump_clear();
-          fflush(stdout);
-          break;
+#ifdef CONFIG_PYXIS_SYSMON_ADAPTIVE
+      g_sysmon.period = SYSMON_IDLE_PERIOD;
+      g_sysmon.calm = 0;
+#endif
+#ifdef SYSMON_HAVE_PROBE
+      nextprobe = now + SYSMON_IDLE_PERIOD * NSEC_PER_MSEC;
+#endif
+    }
 
-        case IRQS:
-          printf("Interrupt info:\n");
-          goto cat;
+    if (g_sysmon.samplenow) {
+      g_sysmon.samplenow = false;
+      if (notectl.enabled)
+        notectl_enable(false, notectlfd);
 
-        case CPULOAD:
-          fd = fopen(feature[i].path, "r");
-          if (!fd) {
-            break;
-          }
-          for (int j = MAX_CPULOAD_HISTORY - 1; j; j--) {
-            clhistory[j] = clhistory[j-1];
-          }
-          ret = fscanf(fd, "%d.%d%%", &clhistory[0], &cl);
-          if (ret < 0) {
-            fclose(fd);
-            break;
-          }
-          printf("CPU load: %d.%d%%\n", clhistory[0], cl);
-          printf("#");
-          for (int j = 0; j < MAX_CPULOAD_HISTORY; j++) {
-            printf("-");
-          }
-          printf("#\n");
-          for (int k = 10; k >= 0; k--) {
-            printf("|");
-            printf("\x1B[35m");
-            for (int j = MAX_CPULOAD_HISTORY - 1; j>=0; j--) {
-              printf(clhistory[j] >= k * 10 ? "*" : ".");
-            }
-            printf("\x1B[0m");
-            printf("|\n");
-          }
-          printf("#");
-          for (int j = 0; j < MAX_CPULOAD_HISTORY; j++) {
-            printf("-");
-          }
-          printf("#\n");
+      sysmon_list_once(now, true);
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+      sysmon_snapshot_publish(SYSMON_SNAPSHOT_RUNNING);
+#endif
+      continue;
+    }
 
-          fclose(fd);
-          break;
+#ifdef SYSMON_HAVE_PROBE
+    if (now >= nextprobe) {
+      sysmon_probe(&sample);
+#ifdef CONFIG_PYXIS_SYSMON_FLIGHTREC
+      sysmon_flight_record(&sample);
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+      sysmon_remote_sample(&sample, now);
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_ADAPTIVE
+      /* While burst sampling every tick prints one compact line, the
+       * collectors keep running at their own periods.
+       */
+
+      sysmon_adapt(&sample);
+      if (g_sysmon.period < SYSMON_IDLE_PERIOD) {
+        sysmon_print_sample(&sample);
+      }
 
-        case MEMINFO:
-          printf("Memory usage:\n");
-          goto cat;
+      nextprobe = now + g_sysmon.period * NSEC_PER_MSEC;
+#else
+      nextprobe = now + SYSMON_IDLE_PERIOD * NSEC_PER_MSEC;
+#endif
+    }
+#endif
 
-        case IOBINFO:
-          printf("IO block usage:\n");
-          goto cat;
+    if (sysmon_next_due() <= now) {
+      if (notectl.enabled)
+        notectl_enable(false, notectlfd);
 
-      default:
-cat:
-        fd = open(feature[i].path, O_RDONLY);
-        if (fd < 0) {
-          break;
-        }
-        buffer = (FAR char*)malloc(1024);
-        if (!buffer) {
-          close(fd);
-          break;
-        }
-        for (;;) {
-          nbytesread = read(fd, buffer, 1024);
-          if (nbytesread < 0) {
-            break;
-          } else if (nbytesread > 0) {
-            int nbyteswritten = 0;
-            while (nbyteswritten < nbytesread) {
-              ssize_t n = fwrite(buffer, sizeof(char), nbytesread, stdout);
-              if (n < 0) {
-                fprintf(stderr, "write to stdout error\n");
-                break;
-              } else {
-                nbyteswritten += n;
-              }
-            }
-          } else {
-            fflush(stdout);
-            break;
-          }
-        }
-        free(buffer);
-        close(fd);
-        break;
-      }
+      sysmon_list_once(now, false);
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+      sysmon_snapshot_publish(SYSMON_SNAPSHOT_RUNNING);
+#endif
     }
   }
-  return exitcode;
-}
-
-/****************************************************************************
- * Name: sysmon_daemon
- ****************************************************************************/
 
-static int sysmon_daemon(int argc, char** argv)
-{
-  int exitcode = EXIT_SUCCESS;
-
-  printf("System Monitor: Running: %d\n", g_sysmon.pid);
-  memset(clhistory, -1, sizeof(clhistory));
-
-  /* Loop until we detect that there is a request to stop. */
-
-  while (!g_sysmon.stop) {
-    /* Wait for the next sample interval */
-    if (notectl.enabled)
-      notectl_enable(true, notectlfd);
-    sleep(CONFIG_PYXIS_SYSMON_INTERVAL);
-    if (notectl.enabled)
-      notectl_enable(false, notectlfd);
+  /* Stopped */
 
-    exitcode = sysmon_list_once(1);
+#ifdef CONFIG_PYXIS_SYSMON_SNAPSHOT
+  sysmon_snapshot_close();
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_REMOTE
+  sysmon_remote_stop();
+#endif
+#ifdef CONFIG_PYXIS_SYSMON_PROFILE
+  sysmon_profile_stop();
+#endif
 
-    if (exitcode != EXIT_SUCCESS) {
-      break;
-    }
+  if (g_sysmon.procdir != NULL) {
+    closedir(g_sysmon.procdir);
+    g_sysmon.procdir = NULL;
   }
 
-  /* Stopped */
+  /* However the stop was asked for, the notes are left off */
+
+  sysmon_deinit();
 
   g_sysmon.stop = false;
   g_sysmon.started = false;
-  if (notectl.enabled)
-    close(notectlfd);
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  sysmon_sink_stop();
+#endif
   printf("System Monitor: Stopped: %d\n", g_sysmon.pid);
 
-  return exitcode;
+  return EXIT_SUCCESS;
 }
 
 /****************************************************************************
@@ -671,7 +3901,13 @@ static int sysmon_daemon(int argc, char** argv)
 
 int sysmon_start_main(int argc, char** argv)
 {
-  sysmon_init();
+  /* The tables, the collector states and notectl of a running daemon
+   * must not be reset under it.
+   */
+
+  if (!g_sysmon.started) {
+    sysmon_init();
+  }
 
   /* Has the monitor already started? */
 
@@ -686,6 +3922,9 @@ int sysmon_start_main(int argc, char** argv)
 
     g_sysmon.started = true;
     g_sysmon.stop = false;
+    g_sysmon.samplenow = false;
+    g_sysmon.newinterval = 0;
+    sem_init(&g_sysmon.wake, 0, 0);
 
     ret = task_create("System Monitor", CONFIG_PYXIS_SYSMON_DAEMON_PRIORITY,
       CONFIG_PYXIS_SYSMON_DAEMON_STACKSIZE,
@@ -694,6 +3933,8 @@ int sysmon_start_main(int argc, char** argv)
       int errcode = errno;
       printf("System Monitor ERROR: Failed to start the monitor: %d\n",
         errcode);
+      g_sysmon.started = false;
+      sysmon_deinit();
     } else {
       g_sysmon.pid = ret;
       printf("System Monitor: Started: %d\n", g_sysmon.pid);
@@ -720,18 +3961,338 @@ int sysmon_stop_main(int argc, char** argv)
 
     printf("System Monitor: Stopping: %d\n", g_sysmon.pid);
     g_sysmon.stop = true;
-    sysmon_deinit();
+    sem_post(&g_sysmon.wake);
   }
 
   printf("System Monitor: Stopped: %d\n", g_sysmon.pid);
   return 0;
 }
 
+int sysmon_ctl_main(int argc, char** argv)
+{
+  FAR struct sysmon_collector_s* c = NULL;
+  bool enable;
+
+  if (!g_sysmon.started || g_sysmon.stop) {
+    printf("System Monitor: Not running\n");
+    return EXIT_FAILURE;
+  }
+
+  if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+    g_sysmon.stop = true;
+  } else if (argc == 2 && strcmp(argv[1], "sample") == 0) {
+    g_sysmon.samplenow = true;
+  } else if (argc == 3 && strcmp(argv[1], "interval") == 0 &&
+             atoi(argv[2]) > 0) {
+    g_sysmon.newinterval = atoi(argv[2]);
+  } else if (argc == 3 && ((enable = strcmp(argv[1], "enable") == 0) ||
+                           strcmp(argv[1], "disable") == 0)) {
+    for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+      if (strcmp(g_collectors[i].name, argv[2]) == 0) {
+        c = &g_collectors[i];
+        break;
+      }
+    }
+
+    if (c == NULL || (enable && c->node != NULL &&
+                      (c->path == NULL || access(c->path, R_OK) < 0))) {
+      printf("System Monitor: No collector %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+
+    c->nerrors = 0;
+    c->due = 0;
+    c->enabled = enable;
+  } else {
+    printf("Usage: %s stop | sample | interval <ms> | "
+      "enable <collector> | disable <collector>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  sem_post(&g_sysmon.wake);
+  return EXIT_SUCCESS;
+}
+
+#ifdef CONFIG_PYXIS_SYSMON_BENCH
+
+#if defined(CONFIG_SCHED_INSTRUMENTATION_SYSCALL) && \
+    defined(CONFIG_DRIVERS_NOTERAM) && defined(CONFIG_DRIVERS_NOTECTL)
+
+/****************************************************************************
+ * Name: sysmon_bench_syscalls
+ *
+ * Description:
+ *   Run one pass with only the syscall notes on and count the system
+ *   calls it issued in the note buffer.  Returns the count, -EOVERFLOW if
+ *   the buffer filled up or a negated errno.
+ *
+ ****************************************************************************/
+
+static int sysmon_bench_syscalls(void)
+{
+  struct note_filter_mode_s saved;
+  struct note_filter_mode_s mode;
+  bool overwrite;
+  int ret;
+
+  if (!notectl.enabled) {
+    return -ENOSYS;
+  }
+
+  overwrite = sysmon_trace_dump_get_overwrite();
+  sysmon_trace_dump_set_overwrite(false);
+  sysmon_trace_dump_clear();
+
+  ioctl(notectlfd, NOTECTL_GETMODE, (unsigned long)&saved);
+  mode = saved;
+  mode.flag = NOTE_FILTER_MODE_FLAG_ENABLE | NOTE_FILTER_MODE_FLAG_SYSCALL;
+  ioctl(notectlfd, NOTECTL_SETMODE, (unsigned long)&mode);
+
+  sysmon_list_once(sysmon_clock(), true);
+  fflush(stdout);
+
+  ioctl(notectlfd, NOTECTL_SETMODE, (unsigned long)&saved);
+  ret = sysmon_trace_count(getpid(), NOTE_SYSCALL_ENTER);
+  sysmon_trace_dump_set_overwrite(overwrite);
+
+  /* The ioctl turning the notes off again is seen too */
+
+  return ret > 0 ? ret - 1 : ret;
+}
+
+#else
+#  define sysmon_bench_syscalls() (-ENOSYS)
+#endif
+
+/****************************************************************************
+ * Name: sysmon_bench_run
+ *
+ * Description:
+ *   Run npasses full passes over the current tree with the output sent to
+ *   /dev/null and print the time and output bytes of one pass.  The system
+ *   calls of one pass are read back from the syscall notes if they are
+ *   instrumented.  The heap blocks and bytes are the change of the heap in
+ *   use over all the passes, from mallinfo().
+ *
+ ****************************************************************************/
+
+static void sysmon_bench_run(int ntasks, int npasses, int nullfd)
+{
+  struct mallinfo before;
+  struct mallinfo after;
+  char syscalls[12];
+  uint64_t start;
+  size_t nbytes;
+  int stdoutfd;
+  int ret;
+
+  fflush(stdout);
+  stdoutfd = dup(STDOUT_FILENO);
+  dup2(nullfd, STDOUT_FILENO);
+
+  /* The first pass over new tasks fills the tables, leave it out */
+
+  sysmon_list_once(sysmon_clock(), true);
+  fflush(stdout);
+
+  ret = sysmon_bench_syscalls();
+  if (ret >= 0) {
+    snprintf(syscalls, sizeof(syscalls), "%d", ret);
+  } else {
+    strlcpy(syscalls, ret == -EOVERFLOW ? "overflow" : "-",
+      sizeof(syscalls));
+  }
+
+  nbytes = g_sysmon.nbytes;
+  before = mallinfo();
+  start = sysmon_clock();
+
+  for (int i = 0; i < npasses; i++) {
+    sysmon_list_once(sysmon_clock(), true);
+  }
+
+  fflush(stdout);
+  start = sysmon_clock() - start;
+  after = mallinfo();
+  dup2(stdoutfd, STDOUT_FILENO);
+  close(stdoutfd);
+
+  printf("%6d %10lu %9s %7d %8d %8zu\n", ntasks,
+    (unsigned long)(start / 1000 / npasses), syscalls,
+    after.aordblks - before.aordblks, after.uordblks - before.uordblks,
+    (g_sysmon.nbytes - nbytes) / npasses);
+}
+
+/****************************************************************************
+ * Name: sysmon_bench_main
+ *
+ * Description:
+ *   Measure the cost of a sampling pass against a synthetic procfs tree
+ *   as the number of tasks doubles up to PYXIS_SYSMON_MAX_TASKS.
+ *
+ ****************************************************************************/
+
+int sysmon_bench_main(int argc, char** argv)
+{
+  FAR const char* root = CONFIG_PYXIS_SYSMON_BENCH_PATH;
+  int maxtasks = CONFIG_PYXIS_SYSMON_MAX_TASKS;
+  int npasses = 10;
+  int nheaps = 2;
+  int nirqs = 16;
+  int ntasks;
+  int nullfd;
+  int ret;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:t:i:m:n:")) != -1) {
+    switch (opt) {
+      case 'd':
+        root = optarg;
+        break;
+      case 't':
+        maxtasks = atoi(optarg);
+        break;
+      case 'i':
+        nirqs = atoi(optarg);
+        break;
+      case 'm':
+        nheaps = atoi(optarg);
+        break;
+      case 'n':
+        npasses = atoi(optarg);
+        break;
+      default:
+        printf("Usage: %s [-d dir] [-t tasks] [-i irqs] [-m heaps] "
+          "[-n passes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (maxtasks < 1 || npasses < 1) {
+    printf("System Monitor: Bad task or pass count\n");
+    return EXIT_FAILURE;
+  }
+
+  if (strlen(root) > SYSMON_ROOT_MAX) {
+    printf("System Monitor: %s is longer than %d characters\n", root,
+      SYSMON_ROOT_MAX);
+    return EXIT_FAILURE;
+  }
+
+  /* The collectors and their tables are shared with the daemon */
+
+  if (g_sysmon.started) {
+    printf("System Monitor: Stop the daemon first\n");
+    return EXIT_FAILURE;
+  }
+
+  nullfd = open("/dev/null", O_WRONLY);
+  if (nullfd < 0) {
+    printf("System Monitor: Failed to open /dev/null: %d\n", errno);
+    return EXIT_FAILURE;
+  }
+
+  ret = sysmon_bench_tree(root, 1, nirqs, nheaps);
+  if (ret < 0) {
+    printf("System Monitor: Failed to create %s: %d\n", root, ret);
+    close(nullfd);
+    return EXIT_FAILURE;
+  }
+
+  /* Point the collectors at the synthetic tree */
+
+  g_sysmon.root = root;
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    free(g_collectors[i].path);
+    g_collectors[i].path = NULL;
+  }
+
+  sysmon_init();
+  memset(clhistory, -1, sizeof(clhistory));
+
+#ifdef CONFIG_DRIVERS_NOTERAM
+  /* The trace buffer is not part of the tree */
+
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    if (g_collectors[i].emit == sysmon_trace_emit) {
+      g_collectors[i].enabled = false;
+    }
+  }
+#endif
+
+  printf("%d irqs, %d heaps, %d passes per step\n", nirqs, nheaps,
+    npasses);
+  printf(" TASKS PASS(us)  SYSCALLS  BLOCKS     HEAP    BYTES\n");
+
+  for (ntasks = 1; ; ntasks *= 2) {
+    if (ntasks > maxtasks) {
+      ntasks = maxtasks;
+    }
+
+    ret = sysmon_bench_tree(root, ntasks, nirqs, nheaps);
+    if (ret < 0) {
+      printf("System Monitor: Failed to grow %s: %d\n", root, ret);
+      break;
+    }
+
+    sysmon_bench_run(ntasks, npasses, nullfd);
+    if (ntasks == maxtasks) {
+      break;
+    }
+  }
+
+  /* Leave the state as a plain sysmon run expects it */
+
+  if (g_sysmon.procdir != NULL) {
+    closedir(g_sysmon.procdir);
+    g_sysmon.procdir = NULL;
+  }
+
+  for (unsigned int i = 0; i < nitems(g_collectors); i++) {
+    free(g_collectors[i].path);
+    g_collectors[i].path = NULL;
+  }
+
+  g_sysmon.root = CONFIG_PYXIS_SYSMON_MOUNTPOINT;
+  g_nheaps = 0;
+  g_nirqs = 0;
+  g_iobvalid = false;
+  g_iobmin = -1;
+  sysmon_deinit();
+  sysmon_bench_clean(root, ntasks);
+  close(nullfd);
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_BENCH */
+
 int main(int argc, char** argv)
 {
+  int exitcode;
+
+  /* A running daemon owns the tables and the output, it takes the pass */
+
+  if (g_sysmon.started) {
+    if (g_sysmon.stop) {
+      printf("System Monitor: Stopping: %d\n", g_sysmon.pid);
+      return EXIT_FAILURE;
+    }
+
+    g_sysmon.samplenow = true;
+    sem_post(&g_sysmon.wake);
+    return EXIT_SUCCESS;
+  }
+
   sysmon_init();
-  return sysmon_list_once(0);
+  memset(clhistory, -1, sizeof(clhistory));
+  exitcode = sysmon_list_once(sysmon_clock(), true);
+  if (g_sysmon.procdir != NULL) {
+    closedir(g_sysmon.procdir);
+    g_sysmon.procdir = NULL;
+  }
+
   sysmon_deinit();
+  return exitcode;
 }
 
 #endif /* CONFIG_PYXIS_SYSMON */
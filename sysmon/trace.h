@@ -26,8 +26,53 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <nuttx/compiler.h>
 
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Tasks followed at once by the dump and by each analysis */
+
+#ifdef CONFIG_PYXIS_SYSMON_MAX_TASKS
+#  define SYSMON_TRACE_MAX_TASKS CONFIG_PYXIS_SYSMON_MAX_TASKS
+#else
+#  define SYSMON_TRACE_MAX_TASKS 32
+#endif
+
+/* Durations are counted in decades, from 10us up to 1s and above */
+
+#define SYSMON_TRACE_DECADES 7
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* The slot of a task in an analysis, one of SYSMON_TRACE_MAX_TASKS.  The
+ * analysis keeps its statistics in an array indexed like the slots.
+ */
+
+struct sysmon_trace_task_s
+{
+  bool used;                    /* The slot holds a task */
+  bool exited;                  /* Kept for the statistics, not looked up */
+  pid_t pid;
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+};
+
+/* The span of the notes an analysis saw since its last report, in ns */
+
+struct sysmon_trace_window_s
+{
+  uint64_t first;
+  uint64_t last;
+};
 
 #ifdef __cplusplus
 #define EXTERN extern "C"
@@ -47,11 +92,12 @@ extern "C"
  * Name: trace_dump
  *
  * Description:
- *   Read notes and dump trace results.
+ *   Read notes and dump trace results.  Returns the number of bytes
+ *   written to out, or a negated errno on failure.
  *
  ****************************************************************************/
 
-int sysmon_trace_dump(FAR FILE *out);
+ssize_t sysmon_trace_dump(FAR FILE *out);
 
 /****************************************************************************
  * Name: trace_dump_clear
@@ -83,12 +129,375 @@ bool sysmon_trace_dump_get_overwrite(void);
 
 void sysmon_trace_dump_set_overwrite(bool mode);
 
+/****************************************************************************
+ * Name: sysmon_trace_count
+ *
+ * Description:
+ *   Read the notes and return how many of the given type task pid left,
+ *   -EOVERFLOW if the buffer filled up and dropped notes, or a negated
+ *   errno.
+ *
+ ****************************************************************************/
+
+int sysmon_trace_count(pid_t pid, int type);
+
+/****************************************************************************
+ * Name: sysmon_trace_printf
+ *
+ * Description:
+ *   Print to out, through the sink for stdout, and count the bytes in the
+ *   result of sysmon_trace_dump().  For the analyses of the dump.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_printf(FAR FILE *out, FAR const char *fmt, ...)
+  printf_like(2, 3);
+
+/****************************************************************************
+ * Name: sysmon_trace_task_find
+ *
+ * Description:
+ *   Return the slot of task pid in tasks, -1 if it has none.
+ *
+ ****************************************************************************/
+
+int sysmon_trace_task_find(FAR const struct sysmon_trace_task_s *tasks,
+                           pid_t pid);
+
+/****************************************************************************
+ * Name: sysmon_trace_task_add
+ *
+ * Description:
+ *   Give task pid a free slot in tasks and return it, -1 if all are used.
+ *   The caller clears its statistics of the slot.
+ *
+ ****************************************************************************/
+
+int sysmon_trace_task_add(FAR struct sysmon_trace_task_s *tasks,
+                          pid_t pid, FAR const char *name);
+
+/****************************************************************************
+ * Name: sysmon_trace_task_exit
+ *
+ * Description:
+ *   Mark the task of a slot as exited.  The slot is no longer found for
+ *   its pid, which may be reused, and stays taken until removed.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_task_exit(FAR struct sysmon_trace_task_s *tasks,
+                            int slot);
+
+/****************************************************************************
+ * Name: sysmon_trace_task_remove
+ *
+ * Description:
+ *   Free a slot of tasks.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_task_remove(FAR struct sysmon_trace_task_s *tasks,
+                              int slot);
+
+/****************************************************************************
+ * Name: sysmon_trace_window_note
+ *
+ * Description:
+ *   Extend window up to a note at time, in ns.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_window_note(FAR struct sysmon_trace_window_s *window,
+                              uint64_t time);
+
+/****************************************************************************
+ * Name: sysmon_trace_window_next
+ *
+ * Description:
+ *   Start the next window where window ended, once it is reported.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_window_next(FAR struct sysmon_trace_window_s *window);
+
+/****************************************************************************
+ * Name: sysmon_trace_decade
+ *
+ * Description:
+ *   Return the decade of a duration in ns, one of SYSMON_TRACE_DECADES.
+ *
+ ****************************************************************************/
+
+int sysmon_trace_decade(uint64_t duration);
+
+/****************************************************************************
+ * Name: sysmon_trace_decade_name
+ *
+ * Description:
+ *   Return the column title of a decade, such as "<10us".
+ *
+ ****************************************************************************/
+
+FAR const char *sysmon_trace_decade_name(int decade);
+
+/****************************************************************************
+ * Name: sysmon_trace_top
+ *
+ * Description:
+ *   Move the ntop first items of base in the order of compare to its
+ *   front, in that order, like a qsort() that stops there.  The rest is
+ *   left in no particular order.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_top(FAR void *base, size_t nmemb, size_t size,
+                      size_t ntop, CODE int (*compare)(FAR const void *,
+                                                       FAR const void *));
+
+#ifdef CONFIG_PYXIS_SYSMON_TRACE_PERIOD
+
+/****************************************************************************
+ * Name: sysmon_trace_period_switch
+ *
+ * Description:
+ *   Account a task switch at time, in ns, to the period analysis.  blocked
+ *   tells whether prev waits for an event rather than being preempted.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_period_switch(uint64_t time, pid_t prev, bool blocked,
+                                pid_t next, FAR const char *name);
+
+/****************************************************************************
+ * Name: sysmon_trace_period_exit
+ *
+ * Description:
+ *   Forget a task that exited.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_period_exit(pid_t pid);
+
+/****************************************************************************
+ * Name: sysmon_trace_period_report
+ *
+ * Description:
+ *   Print the period, jitter, missed periods and run time per activation
+ *   of the periodic tasks seen since the last report, and start a new
+ *   window.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_period_report(FAR FILE *out);
+
+#else
+
+#define sysmon_trace_period_switch(time, prev, blocked, next, name)
+#define sysmon_trace_period_exit(pid)
+#define sysmon_trace_period_report(out)
+
+#endif /* CONFIG_PYXIS_SYSMON_TRACE_PERIOD */
+
+#if defined(CONFIG_PYXIS_SYSMON_TRACE_CPU) && defined(CONFIG_SMP)
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_switch
+ *
+ * Description:
+ *   Account a task switch on cpu at time, in ns, to the CPU balance
+ *   analysis.  blocked tells whether prev waits for an event rather than
+ *   being preempted.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_cpu_switch(uint64_t time, int cpu, pid_t prev,
+                             bool blocked, pid_t next, FAR const char *name);
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_note
+ *
+ * Description:
+ *   Account a NOTE_CPU_* note of cpu about target to the CPU balance
+ *   analysis.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_cpu_note(uint64_t time, int cpu, int type, int target);
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_exit
+ *
+ * Description:
+ *   Forget a task that exited.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_cpu_exit(pid_t pid);
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_report
+ *
+ * Description:
+ *   Print the busy time, runnable tasks and pauses of each CPU and the
+ *   migrations of each task since the last report, and start a new
+ *   window.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_cpu_report(FAR FILE *out);
+
+#else
+
+#define sysmon_trace_cpu_switch(time, cpu, prev, blocked, next, name)
+#define sysmon_trace_cpu_note(time, cpu, type, target)
+#define sysmon_trace_cpu_exit(pid)
+#define sysmon_trace_cpu_report(out)
+
+#endif /* CONFIG_PYXIS_SYSMON_TRACE_CPU && CONFIG_SMP */
+
+#ifdef CONFIG_PYXIS_SYSMON_TRACE_HEAP
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_note
+ *
+ * Description:
+ *   Account a NOTE_HEAP_* note of task pid at time, in ns, to the heap
+ *   analysis.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_heap_note(uint64_t time, int type, pid_t pid,
+                            FAR const char *name, FAR void *mem,
+                            size_t size);
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_exit
+ *
+ * Description:
+ *   Note that a task exited.  Its slot is freed by the next report once
+ *   none of the blocks it allocated is live.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_heap_exit(pid_t pid);
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_report
+ *
+ * Description:
+ *   Print the allocations per task and size class, the lifetimes, the
+ *   most frequent sizes and the blocks still live since the last report,
+ *   and start a new window.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_heap_report(FAR FILE *out);
+
+#else
+
+#define sysmon_trace_heap_note(time, type, pid, name, mem, size)
+#define sysmon_trace_heap_exit(pid)
+#define sysmon_trace_heap_report(out)
+
+#endif /* CONFIG_PYXIS_SYSMON_TRACE_HEAP */
+
+#ifdef CONFIG_PYXIS_SYSMON_TRACE_IDLE
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_switch
+ *
+ * Description:
+ *   Account a switch to next on cpu at time, in ns, to the idle analysis.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_idle_switch(uint64_t time, int cpu, pid_t next,
+                              FAR const char *name);
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_irq
+ *
+ * Description:
+ *   Account the entry or the exit of an interrupt handler on cpu to the
+ *   idle analysis.  The exit is passed after the switch it causes.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_idle_irq(uint64_t time, int cpu, int irq, bool enter);
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_report
+ *
+ * Description:
+ *   Print the idle time, wakeup rate and idle period lengths of each CPU
+ *   and the most frequent wakeup sources since the last report, and start
+ *   a new window.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_idle_report(FAR FILE *out);
+
+#else
+
+#define sysmon_trace_idle_switch(time, cpu, next, name)
+#define sysmon_trace_idle_irq(time, cpu, irq, enter)
+#define sysmon_trace_idle_report(out)
+
+#endif /* CONFIG_PYXIS_SYSMON_TRACE_IDLE */
+
+#ifdef CONFIG_PYXIS_SYSMON_TRACE_RATE
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_note
+ *
+ * Description:
+ *   Account a note of length bytes and task pid at time, in ns, to the
+ *   trace rate meter.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_rate_note(uint64_t time, int type, pid_t pid,
+                            FAR const char *name, size_t length);
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_exit
+ *
+ * Description:
+ *   Note that a task exited.  Its slot is freed by the next report.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_rate_exit(pid_t pid);
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_report
+ *
+ * Description:
+ *   Print the note rate per family and task since the last report, how
+ *   long the buffer holds at that rate and the buffer size or filters for
+ *   the target window, and start a new window.  mode is the noteram mode
+ *   before the notes were read.
+ *
+ ****************************************************************************/
+
+void sysmon_trace_rate_report(FAR FILE *out, int mode);
+
+#else
+
+#define sysmon_trace_rate_note(time, type, pid, name, length)
+#define sysmon_trace_rate_exit(pid)
+#define sysmon_trace_rate_report(out, mode) ((void)(out), (void)(mode))
+
+#endif /* CONFIG_PYXIS_SYSMON_TRACE_RATE */
+
 #else /* CONFIG_DRIVERS_NOTERAM */
 
-#define sysmon_trace_dump(out)
+#define sysmon_trace_dump(out)                 ((void)(out), 0)
 #define sysmon_trace_dump_clear()
 #define sysmon_trace_dump_get_overwrite()      0
 #define sysmon_trace_dump_set_overwrite(mode)  (void)(mode)
+#define sysmon_trace_count(pid, type)          ((void)(pid), (void)(type), \
+                                                -ENOSYS)
 
 #endif /* CONFIG_DRIVERS_NOTERAM */
 
@@ -0,0 +1,428 @@
+/****************************************************************************
+ * apps/system/sysmon/trace_cpu.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <nuttx/clock.h>
+#include <nuttx/sched_note.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NCPUS CONFIG_SMP_NCPUS
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One task.  A task switched out without blocking waits in the ready list
+ * and is counted as runnable on the CPU it was preempted from.
+ */
+
+struct cpu_task_s
+{
+  int cpu;                      /* CPU it last ran on, -1 if none yet */
+  bool ready;                   /* Preempted, waiting to run again */
+  uint64_t resumed;             /* Last switch in */
+  uint32_t switches;            /* Switches in during the window */
+  uint32_t migrations;          /* Of them, on another CPU than the last */
+  uint64_t run[NCPUS];          /* Run time per CPU during the window */
+};
+
+struct cpu_state_s
+{
+  pid_t running;                /* Task on the CPU, < NCPUS when idle */
+  int nready;                   /* Ready tasks preempted from the CPU */
+  uint64_t busy;                /* Non idle time during the window */
+  uint64_t runnable;            /* Integral of the runnable tasks */
+  uint64_t pause;               /* Pause requested, 0 if none */
+  uint64_t paused;              /* Paused, 0 if running */
+  uint32_t npauses;
+  uint64_t pausetime;           /* Time spent paused */
+  uint64_t pausemax;            /* Longest pause */
+  uint64_t latencymax;          /* Longest time to honour a pause request */
+};
+
+struct cpu_s
+{
+  bool init;
+  struct sysmon_trace_window_s window;
+  uint64_t starved;             /* A CPU idle while tasks were waiting */
+  struct cpu_state_s cpus[NCPUS];
+  struct sysmon_trace_task_s slots[SYSMON_TRACE_MAX_TASKS];
+  struct cpu_task_s tasks[SYSMON_TRACE_MAX_TASKS];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct cpu_s g_cpu;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cpu_init
+ ****************************************************************************/
+
+static void cpu_init(void)
+{
+  int i;
+
+  for (i = 0; i < NCPUS; i++)
+    {
+      g_cpu.cpus[i].running = i;
+    }
+
+  g_cpu.init = true;
+}
+
+/****************************************************************************
+ * Name: cpu_get
+ *
+ * Description:
+ *   Return the slot of task pid, taking a free one if name is not NULL,
+ *   -1 if none.
+ *
+ ****************************************************************************/
+
+static int cpu_get(pid_t pid, FAR const char *name)
+{
+  int slot = sysmon_trace_task_find(g_cpu.slots, pid);
+
+  if (slot >= 0 || name == NULL)
+    {
+      return slot;
+    }
+
+  slot = sysmon_trace_task_add(g_cpu.slots, pid, name);
+  if (slot >= 0)
+    {
+      memset(&g_cpu.tasks[slot], 0, sizeof(g_cpu.tasks[slot]));
+      g_cpu.tasks[slot].cpu = -1;
+    }
+
+  return slot;
+}
+
+/****************************************************************************
+ * Name: cpu_advance
+ *
+ * Description:
+ *   Integrate the CPU states from the last note up to time.  The notes of
+ *   different CPUs may come slightly out of order, time never goes back.
+ *
+ ****************************************************************************/
+
+static void cpu_advance(uint64_t time)
+{
+  FAR struct cpu_state_s *state;
+  uint64_t last = g_cpu.window.last;
+  uint64_t delta;
+  bool idle = false;
+  int nready = 0;
+  int cpu;
+
+  if (!g_cpu.init)
+    {
+      cpu_init();
+    }
+
+  sysmon_trace_window_note(&g_cpu.window, time);
+  if (last == 0 || time <= last)
+    {
+      return;
+    }
+
+  delta = time - last;
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      state = &g_cpu.cpus[cpu];
+      nready += state->nready;
+      if (state->running >= NCPUS)
+        {
+          state->busy += delta;
+          state->runnable += delta;
+        }
+      else if (state->paused == 0)
+        {
+          idle = true;
+        }
+
+      state->runnable += delta * state->nready;
+    }
+
+  if (idle && nready > 0)
+    {
+      g_cpu.starved += delta;
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_switch
+ ****************************************************************************/
+
+void sysmon_trace_cpu_switch(uint64_t time, int cpu, pid_t prev,
+                             bool blocked, pid_t next, FAR const char *name)
+{
+  FAR struct cpu_task_s *task;
+  int slot;
+
+  cpu_advance(time);
+  g_cpu.cpus[cpu].running = next;
+
+  if (prev >= NCPUS && (slot = cpu_get(prev, NULL)) >= 0)
+    {
+      task = &g_cpu.tasks[slot];
+      if (task->resumed != 0 && time > task->resumed)
+        {
+          task->run[cpu] += time - task->resumed;
+        }
+
+      task->resumed = 0;
+      if (!blocked && !task->ready)
+        {
+          task->ready = true;
+          g_cpu.cpus[cpu].nready++;
+        }
+    }
+
+  if (next < NCPUS || (slot = cpu_get(next, name)) < 0)
+    {
+      return;
+    }
+
+  task = &g_cpu.tasks[slot];
+  if (task->ready)
+    {
+      task->ready = false;
+      g_cpu.cpus[task->cpu].nready--;
+    }
+
+  if (task->cpu >= 0 && task->cpu != cpu)
+    {
+      task->migrations++;
+    }
+
+  task->cpu = cpu;
+  task->switches++;
+  task->resumed = time;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_note
+ ****************************************************************************/
+
+void sysmon_trace_cpu_note(uint64_t time, int cpu, int type, int target)
+{
+  FAR struct cpu_state_s *state;
+  uint64_t delta;
+
+  cpu_advance(time);
+
+  switch (type)
+    {
+      case NOTE_CPU_PAUSE:
+        if (target >= 0 && target < NCPUS)
+          {
+            g_cpu.cpus[target].pause = time;
+          }
+        break;
+
+      case NOTE_CPU_PAUSED:
+        state = &g_cpu.cpus[cpu];
+        state->paused = time;
+        state->npauses++;
+        if (state->pause != 0 && time > state->pause)
+          {
+            delta = time - state->pause;
+            if (delta > state->latencymax)
+              {
+                state->latencymax = delta;
+              }
+          }
+
+        state->pause = 0;
+        break;
+
+      case NOTE_CPU_RESUMED:
+        state = &g_cpu.cpus[cpu];
+        if (state->paused != 0 && time > state->paused)
+          {
+            delta = time - state->paused;
+            state->pausetime += delta;
+            if (delta > state->pausemax)
+              {
+                state->pausemax = delta;
+              }
+          }
+
+        state->paused = 0;
+        break;
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_exit
+ ****************************************************************************/
+
+void sysmon_trace_cpu_exit(pid_t pid)
+{
+  int slot;
+
+  if (!g_cpu.init)
+    {
+      return;
+    }
+
+  slot = cpu_get(pid, NULL);
+  if (slot >= 0)
+    {
+      if (g_cpu.tasks[slot].ready)
+        {
+          g_cpu.cpus[g_cpu.tasks[slot].cpu].nready--;
+        }
+
+      sysmon_trace_task_remove(g_cpu.slots, slot);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_cpu_report
+ ****************************************************************************/
+
+void sysmon_trace_cpu_report(FAR FILE *out)
+{
+  FAR struct cpu_state_s *state;
+  FAR struct cpu_task_s *task;
+  uint64_t window = g_cpu.window.last - g_cpu.window.first;
+  uint64_t runnable;
+  uint64_t lo = UINT64_MAX;
+  uint64_t hi = 0;
+  int cpu;
+  int i;
+
+  if (!g_cpu.init || window == 0)
+    {
+      return;
+    }
+
+  /* Runnable is the average number of tasks running or waiting to run on
+   * the CPU, in hundredths.
+   */
+
+  sysmon_trace_printf(out, "CPU balance (us):\n"
+                      "CPU  BUSY%% RUNNABLE PAUSES PAUSETIME PAUSEMAX"
+                      " LATENCYMAX\n");
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      state = &g_cpu.cpus[cpu];
+      runnable = state->runnable * 100 / window;
+      if (runnable < lo)
+        {
+          lo = runnable;
+        }
+
+      if (runnable > hi)
+        {
+          hi = runnable;
+        }
+
+      sysmon_trace_printf(out, "%3d %5" PRIu64 " %5" PRIu64 ".%02" PRIu64
+                          " %6" PRIu32 " %9" PRIu64 " %8" PRIu64
+                          " %10" PRIu64 "\n", cpu,
+                          state->busy * 100 / window,
+                          runnable / 100, runnable % 100, state->npauses,
+                          state->pausetime / NSEC_PER_USEC,
+                          state->pausemax / NSEC_PER_USEC,
+                          state->latencymax / NSEC_PER_USEC);
+
+      state->busy = 0;
+      state->runnable = 0;
+      state->npauses = 0;
+      state->pausetime = 0;
+      state->pausemax = 0;
+      state->latencymax = 0;
+    }
+
+  sysmon_trace_printf(out, "Imbalance %" PRIu64 ".%02" PRIu64
+                      ", idle with tasks waiting %" PRIu64 "us (%" PRIu64
+                      "%%)\n", (hi - lo) / 100, (hi - lo) % 100,
+                      g_cpu.starved / NSEC_PER_USEC,
+                      g_cpu.starved * 100 / window);
+
+  sysmon_trace_printf(out, "  PID SWITCHES MIGRATIONS MIGR%%");
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      sysmon_trace_printf(out, "   RUN_CPU%d", cpu);
+    }
+
+  sysmon_trace_printf(out, " NAME\n");
+
+  for (i = 0; i < SYSMON_TRACE_MAX_TASKS; i++)
+    {
+      task = &g_cpu.tasks[i];
+      if (!g_cpu.slots[i].used || task->switches == 0)
+        {
+          continue;
+        }
+
+      sysmon_trace_printf(out, "%5d %8" PRIu32 " %10" PRIu32 " %5" PRIu32,
+                          g_cpu.slots[i].pid, task->switches,
+                          task->migrations,
+                          task->migrations * 100 / task->switches);
+      for (cpu = 0; cpu < NCPUS; cpu++)
+        {
+          sysmon_trace_printf(out, " %10" PRIu64,
+                              task->run[cpu] / NSEC_PER_USEC);
+          task->run[cpu] = 0;
+        }
+
+      sysmon_trace_printf(out, " %s\n", g_cpu.slots[i].name);
+      task->switches = 0;
+      task->migrations = 0;
+    }
+
+  sysmon_trace_printf(out, "\n");
+  sysmon_trace_window_next(&g_cpu.window);
+  g_cpu.starved = 0;
+}
@@ -24,15 +24,20 @@
 
 #include <nuttx/config.h>
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <nuttx/clock.h>
 #include <nuttx/sched_note.h>
 #include <nuttx/note/noteram_driver.h>
 
+#include "sink.h"
 #include "trace.h"
 
 #ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
@@ -64,6 +69,18 @@
 
 #define get_task_state(s) ((s) <= LAST_READY_TO_RUN_STATE ? 'R' : 'S')
 
+#ifndef CONFIG_PYXIS_SYSMON_TRACE_REORDER
+#  define CONFIG_PYXIS_SYSMON_TRACE_REORDER 0
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRACE_REORDER_WINDOW
+#  define CONFIG_PYXIS_SYSMON_TRACE_REORDER_WINDOW 100
+#endif
+
+#define TRACE_DUMP_REORDER CONFIG_PYXIS_SYSMON_TRACE_REORDER
+
+#define TRACE_DUMP_LINESIZE 256
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -91,13 +108,68 @@ struct trace_dump_context_s
 {
   struct trace_dump_cpu_context_s cpu[NCPUS];
   FAR struct trace_dump_task_context_s *task;
+  int ntasks;             /* Task contexts taken from the pool */
   int notefd;
+  uint64_t time;          /* Time of the note being dumped, in ns */
+#if TRACE_DUMP_REORDER > 0
+  int nnotes;             /* Notes held in the reorder window */
+  uint8_t order[TRACE_DUMP_REORDER];  /* Held notes, oldest first */
+#endif
+};
+
+/* The note time stamps are 32 bits, seconds with HIRES and ticks
+ * otherwise.  They are extended to 64 bits across the dumps: the last
+ * value seen is the reference and a note is placed at the nearest
+ * distance from it, so a wrap moves forward and a note slightly older
+ * than the previous one, from another CPU, stays before it.
+ */
+
+struct trace_dump_clock_s
+{
+  bool valid;
+  int64_t last;           /* Extended seconds or ticks of the newest note */
+};
+
+#if TRACE_DUMP_REORDER > 0
+struct trace_dump_note_s
+{
+  uint64_t time;
+  uint8_t data[UCHAR_MAX];
 };
+#endif
 
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+static size_t g_trace_nbytes;   /* Bytes emitted by the running dump */
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+/* The console line being built by several sysmon_trace_printf() calls,
+ * e.g. a note header and its body.  It is queued to the sink in one write
+ * so a drop never tears it.  Only the dump prints here, from the daemon.
+ */
+
+static char g_trace_line[TRACE_DUMP_LINESIZE];
+static size_t g_trace_linelen;
+#endif
+
+/* Task contexts come from a fixed pool so a dump never touches the heap */
+
+static struct trace_dump_task_context_s
+  g_trace_tasks[SYSMON_TRACE_MAX_TASKS];
+
+static struct trace_dump_clock_s g_trace_clock;
+
+static FAR const char * const g_trace_decades[SYSMON_TRACE_DECADES] =
+{
+  "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"
+};
+
+#if TRACE_DUMP_REORDER > 0
+static struct trace_dump_note_s g_trace_notes[TRACE_DUMP_REORDER];
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -145,6 +217,10 @@ static void trace_dump_init_context(FAR struct trace_dump_context_s *ctx,
     }
 
   ctx->task = NULL;
+  ctx->ntasks = 0;
+#if TRACE_DUMP_REORDER > 0
+  ctx->nnotes = 0;
+#endif
 }
 
 /****************************************************************************
@@ -153,19 +229,10 @@ static void trace_dump_init_context(FAR struct trace_dump_context_s *ctx,
 
 static void trace_dump_fini_context(FAR struct trace_dump_context_s *ctx)
 {
-  FAR struct trace_dump_task_context_s *tctx;
-  FAR struct trace_dump_task_context_s *ntctx;
+  /* Finalize the trace dump context, giving the task contexts back */
 
-  /* Finalize the trace dump context */
-
-  tctx = ctx->task;
   ctx->task = NULL;
-  while (tctx != NULL)
-    {
-      ntctx = tctx->next;
-      free(tctx);
-      tctx = ntctx;
-    }
+  ctx->ntasks = 0;
 }
 
 /****************************************************************************
@@ -218,29 +285,30 @@ FAR static struct trace_dump_task_context_s *get_task_context(pid_t pid,
 
   /* Create new trace dump task context */
 
-  *tctxp = (FAR struct trace_dump_task_context_s *)
-           malloc(sizeof(struct trace_dump_task_context_s));
-  if (*tctxp != NULL)
+  if (ctx->ntasks >= SYSMON_TRACE_MAX_TASKS)
     {
-      (*tctxp)->next = NULL;
-      (*tctxp)->pid = pid;
-      (*tctxp)->syscall_nest = 0;
-      (*tctxp)->name[0] = '\0';
+      return NULL;
+    }
+
+  *tctxp = &g_trace_tasks[ctx->ntasks++];
+  (*tctxp)->next = NULL;
+  (*tctxp)->pid = pid;
+  (*tctxp)->syscall_nest = 0;
+  (*tctxp)->name[0] = '\0';
 
 #if CONFIG_DRIVERS_NOTERAM_TASKNAME_BUFSIZE > 0
-        {
-          struct noteram_get_taskname_s tnm;
-          int res;
+    {
+      struct noteram_get_taskname_s tnm;
+      int res;
 
-          tnm.pid = pid;
-          res = ioctl(ctx->notefd, NOTERAM_GETTASKNAME, (unsigned long)&tnm);
-          if (res == 0)
-            {
-              copy_task_name((*tctxp)->name, tnm.taskname);
-            }
+      tnm.pid = pid;
+      res = ioctl(ctx->notefd, NOTERAM_GETTASKNAME, (unsigned long)&tnm);
+      if (res == 0)
+        {
+          copy_task_name((*tctxp)->name, tnm.taskname);
         }
-#endif
     }
+#endif
 
   return *tctxp;
 }
@@ -264,29 +332,67 @@ static const char *get_task_name(pid_t pid,
 }
 
 /****************************************************************************
- * Name: trace_dump_header
+ * Name: trace_dump_time
+ *
+ * Description:
+ *   Return the time stamp of a note in ns, extended to 64 bits.  Notes
+ *   must be passed in the order of the buffer.
+ *
  ****************************************************************************/
 
-static void trace_dump_header(FAR FILE *out,
-                              FAR struct note_common_s *note,
-                              FAR struct trace_dump_context_s *ctx)
+static uint64_t trace_dump_time(FAR struct note_common_s *note)
 {
-  pid_t pid;
 #ifdef CONFIG_SCHED_INSTRUMENTATION_HIRES
   uint32_t nsec = note->nc_systime_nsec[0] +
                   (note->nc_systime_nsec[1] << 8) +
                   (note->nc_systime_nsec[2] << 16) +
                   (note->nc_systime_nsec[3] << 24);
-  uint32_t sec = note->nc_systime_sec[0] +
+  uint32_t raw = note->nc_systime_sec[0] +
                  (note->nc_systime_sec[1] << 8) +
                  (note->nc_systime_sec[2] << 16) +
                  (note->nc_systime_sec[3] << 24);
 #else
-  uint32_t systime = note->nc_systime[0] +
-                     (note->nc_systime[1] << 8) +
-                     (note->nc_systime[2] << 16) +
-                     (note->nc_systime[3] << 24);
+  uint32_t raw = note->nc_systime[0] +
+                 (note->nc_systime[1] << 8) +
+                 (note->nc_systime[2] << 16) +
+                 (note->nc_systime[3] << 24);
+#endif
+  int64_t value;
+
+  if (!g_trace_clock.valid)
+    {
+      g_trace_clock.last = raw;
+      g_trace_clock.valid = true;
+    }
+
+  value = g_trace_clock.last +
+          (int32_t)(raw - (uint32_t)g_trace_clock.last);
+  if (value > g_trace_clock.last)
+    {
+      g_trace_clock.last = value;
+    }
+
+  if (value < 0)
+    {
+      value = 0;
+    }
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_HIRES
+  return value * 1000000000ull + nsec;
+#else
+  return value * (uint64_t)CONFIG_USEC_PER_TICK * 1000;
 #endif
+}
+
+/****************************************************************************
+ * Name: trace_dump_header
+ ****************************************************************************/
+
+static void trace_dump_header(FAR FILE *out,
+                              FAR struct note_common_s *note,
+                              FAR struct trace_dump_context_s *ctx)
+{
+  pid_t pid;
 #ifdef CONFIG_SMP
   int cpu = note->nc_cpu;
 #else
@@ -295,16 +401,9 @@ static void trace_dump_header(FAR FILE *out,
 
   pid = ctx->cpu[cpu].current_pid;
 
-  fprintf(out, "[%d] %3u.%09u: %9s-%-3u",
-          cpu,
-#ifdef CONFIG_SCHED_INSTRUMENTATION_HIRES
-          sec, nsec
-#else
-          systime / (1000 * 1000 / CONFIG_USEC_PER_TICK),
-          (systime % (1000 * 1000 / CONFIG_USEC_PER_TICK))
-            * CONFIG_USEC_PER_TICK * 1000
-#endif
-         , get_task_name(pid, ctx), get_pid(pid));
+  sysmon_trace_printf(out, "[%d] %3" PRIu64 ".%09" PRIu64 ": %9s-%-3u",
+                      cpu, ctx->time / 1000000000, ctx->time % 1000000000,
+                      get_task_name(pid, ctx), get_pid(pid));
 }
 
 /****************************************************************************
@@ -316,6 +415,7 @@ static void trace_dump_sched_switch(FAR FILE *out,
                                     FAR struct trace_dump_context_s *ctx)
 {
   FAR struct trace_dump_cpu_context_s *cctx;
+  FAR const char *next_name;
   pid_t current_pid;
   pid_t next_pid;
 #ifdef CONFIG_SMP
@@ -327,10 +427,19 @@ static void trace_dump_sched_switch(FAR FILE *out,
   cctx = &ctx->cpu[cpu];
   current_pid = cctx->current_pid;
   next_pid = cctx->next_pid;
+  next_name = get_task_name(next_pid, ctx);
+
+  sysmon_trace_printf(out, "%c ==> %s-%u\n",
+                      get_task_state(cctx->current_state),
+                      next_name, get_pid(next_pid));
 
-  fprintf(out, "%c ==> %s-%u\n",
-          get_task_state(cctx->current_state),
-          get_task_name(next_pid, ctx), get_pid(next_pid));
+  sysmon_trace_period_switch(ctx->time, current_pid,
+                             get_task_state(cctx->current_state) == 'S',
+                             next_pid, next_name);
+  sysmon_trace_cpu_switch(ctx->time, cpu, current_pid,
+                          get_task_state(cctx->current_state) == 'S',
+                          next_pid, next_name);
+  sysmon_trace_idle_switch(ctx->time, cpu, next_pid, next_name);
 
   cctx->current_pid = cctx->next_pid;
   cctx->pendingswitch = false;
@@ -356,6 +465,9 @@ static int trace_dump_one(FAR FILE *out,
   cctx = &ctx->cpu[cpu];
   pid = note->nc_pid[0] + (note->nc_pid[1] << 8);
 
+  sysmon_trace_rate_note(ctx->time, note->nc_type, pid,
+                         get_task_name(pid, ctx), note->nc_length);
+
   if (note->nc_type != NOTE_START &&
       note->nc_type != NOTE_STOP &&
       note->nc_type != NOTE_RESUME
@@ -386,18 +498,24 @@ static int trace_dump_one(FAR FILE *out,
 #endif
 
           trace_dump_header(out, note, ctx);
-          fprintf(out, "sched_wakeup_new: comm=%s pid=%d target_cpu=%d\n",
-                  get_task_name(pid, ctx), get_pid(pid), cpu);
+          sysmon_trace_printf(out,
+                              "sched_wakeup_new: comm=%s pid=%d "
+                              "target_cpu=%d\n",
+                              get_task_name(pid, ctx), get_pid(pid), cpu);
         }
         break;
 
       case NOTE_STOP:
         {
           trace_dump_header(out, note, ctx);
-          fprintf(out, "%c ==> %s-%u\n",
-                  'X',
-                  get_task_name(cctx->current_pid, ctx),
-                  get_pid(cctx->current_pid));
+          sysmon_trace_printf(out, "%c ==> %s-%u\n",
+                              'X',
+                              get_task_name(cctx->current_pid, ctx),
+                              get_pid(cctx->current_pid));
+          sysmon_trace_period_exit(pid);
+          sysmon_trace_cpu_exit(pid);
+          sysmon_trace_heap_exit(pid);
+          sysmon_trace_rate_exit(pid);
         }
         break;
 
@@ -437,14 +555,74 @@ static int trace_dump_one(FAR FILE *out,
                */
 
               trace_dump_header(out, note, ctx);
-              fprintf(out, "sched_waking: comm=%s pid=%d target_cpu=%d\n",
-                      get_task_name(cctx->next_pid, ctx),
-                      get_pid(cctx->next_pid), cpu);
+              sysmon_trace_printf(out,
+                                  "sched_waking: comm=%s pid=%d "
+                                  "target_cpu=%d\n",
+                                  get_task_name(cctx->next_pid, ctx),
+                                  get_pid(cctx->next_pid), cpu);
               cctx->pendingswitch = true;
             }
         }
         break;
 
+#ifdef CONFIG_SMP
+      case NOTE_CPU_START:
+        {
+          FAR struct note_cpu_start_s *ncs;
+
+          ncs = (FAR struct note_cpu_start_s *)p;
+          trace_dump_header(out, note, ctx);
+          sysmon_trace_printf(out, "cpu_start: target_cpu=%d\n",
+                              ncs->ncs_target);
+          sysmon_trace_cpu_note(ctx->time, cpu, note->nc_type,
+                                ncs->ncs_target);
+        }
+        break;
+
+      case NOTE_CPU_PAUSE:
+        {
+          FAR struct note_cpu_pause_s *ncp;
+
+          ncp = (FAR struct note_cpu_pause_s *)p;
+          trace_dump_header(out, note, ctx);
+          sysmon_trace_printf(out, "cpu_pause: target_cpu=%d\n",
+                              ncp->ncp_target);
+          sysmon_trace_cpu_note(ctx->time, cpu, note->nc_type,
+                                ncp->ncp_target);
+        }
+        break;
+
+      case NOTE_CPU_RESUME:
+        {
+          FAR struct note_cpu_resume_s *ncr;
+
+          ncr = (FAR struct note_cpu_resume_s *)p;
+          trace_dump_header(out, note, ctx);
+          sysmon_trace_printf(out, "cpu_resume: target_cpu=%d\n",
+                              ncr->ncr_target);
+          sysmon_trace_cpu_note(ctx->time, cpu, note->nc_type,
+                                ncr->ncr_target);
+        }
+        break;
+
+      case NOTE_CPU_STARTED:
+      case NOTE_CPU_PAUSED:
+      case NOTE_CPU_RESUMED:
+        {
+          /* Emitted by the target CPU itself */
+
+          trace_dump_header(out, note, ctx);
+          sysmon_trace_printf(out, "%s\n",
+                              note->nc_type == NOTE_CPU_STARTED ?
+                              "cpu_started" :
+                              note->nc_type == NOTE_CPU_PAUSED ?
+                              "cpu_paused" : "cpu_resumed");
+          sysmon_trace_cpu_note(ctx->time, cpu, note->nc_type,
+                                cpu);
+        }
+        break;
+#endif
+
 #ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
       case NOTE_SYSCALL_ENTER:
         {
@@ -483,8 +661,8 @@ static int trace_dump_one(FAR FILE *out,
             }
 
           trace_dump_header(out, note, ctx);
-          fprintf(out, "sys_%s(",
-                  g_funcnames[nsc->nsc_nr - CONFIG_SYS_RESERVED]);
+          sysmon_trace_printf(out, "sys_%s(",
+                              g_funcnames[nsc->nsc_nr - CONFIG_SYS_RESERVED]);
 
           for (i = j = 0; i < nsc->nsc_argc; i++)
             {
@@ -502,15 +680,15 @@ static int trace_dump_one(FAR FILE *out,
 #endif
               if (i == 0)
                 {
-                  fprintf(out, "arg%d: 0x%x", i, arg);
+                  sysmon_trace_printf(out, "arg%d: 0x%x", i, arg);
                 }
               else
                 {
-                  fprintf(out, ", arg%d: 0x%x", i, arg);
+                  sysmon_trace_printf(out, ", arg%d: 0x%x", i, arg);
                 }
             }
 
-          fprintf(out, ")\n");
+          sysmon_trace_printf(out, ")\n");
         }
         break;
 
@@ -566,9 +744,38 @@ static int trace_dump_one(FAR FILE *out,
 #endif
           ;
 
-          fprintf(out, "sys_%s -> 0x%" PRIxPTR "\n",
-                  g_funcnames[nsc->nsc_nr - CONFIG_SYS_RESERVED],
-                  result);
+          sysmon_trace_printf(out, "sys_%s -> 0x%" PRIxPTR "\n",
+                              g_funcnames[nsc->nsc_nr - CONFIG_SYS_RESERVED],
+                              result);
+        }
+        break;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_HEAP
+      case NOTE_HEAP_ADD:
+      case NOTE_HEAP_REMOVE:
+      case NOTE_HEAP_ALLOC:
+      case NOTE_HEAP_FREE:
+        {
+          static FAR const char * const names[] =
+            {
+              "add", "remove", "malloc", "free"
+            };
+
+          struct note_heap_s nmm;
+
+          /* The pointers in the note are not aligned in the buffer */
+
+          memcpy(&nmm, p, sizeof(nmm));
+          trace_dump_header(out, note, ctx);
+          sysmon_trace_printf(out, "tracing_mark_write: C|%d|Heap Usage|"
+                              "%zu|%s: heap=%p size=%zu, address=%p\n",
+                              get_pid(pid), nmm.used,
+                              names[note->nc_type - NOTE_HEAP_ADD],
+                              nmm.heap, nmm.size, nmm.mem);
+          sysmon_trace_heap_note(ctx->time, note->nc_type,
+                                 pid, get_task_name(pid, ctx), nmm.mem,
+                                 nmm.size);
         }
         break;
 #endif
@@ -580,9 +787,11 @@ static int trace_dump_one(FAR FILE *out,
 
           nih = (FAR struct note_irqhandler_s *)p;
           trace_dump_header(out, note, ctx);
-          fprintf(out, "irq_handler_entry: irq=%u\n",
-                  nih->nih_irq);
+          sysmon_trace_printf(out, "irq_handler_entry: irq=%u\n",
+                              nih->nih_irq);
           cctx->intr_nest++;
+          sysmon_trace_idle_irq(ctx->time, cpu, nih->nih_irq,
+                                true);
         }
         break;
 
@@ -592,8 +801,8 @@ static int trace_dump_one(FAR FILE *out,
 
           nih = (FAR struct note_irqhandler_s *)p;
           trace_dump_header(out, note, ctx);
-          fprintf(out, "irq_handler_exit: irq=%u\n",
-                  nih->nih_irq);
+          sysmon_trace_printf(out, "irq_handler_exit: irq=%u\n",
+                              nih->nih_irq);
           cctx->intr_nest--;
 
           if (cctx->intr_nest <= 0)
@@ -607,6 +816,9 @@ static int trace_dump_one(FAR FILE *out,
                   trace_dump_sched_switch(out, note, ctx);
                 }
             }
+
+          sysmon_trace_idle_irq(ctx->time, cpu, nih->nih_irq,
+                                false);
         }
         break;
 #endif
@@ -620,10 +832,195 @@ static int trace_dump_one(FAR FILE *out,
   return note->nc_length;
 }
 
+/****************************************************************************
+ * Name: trace_dump_note
+ *
+ * Description:
+ *   Time stamp one note read from the buffer and dump it.  With the
+ *   reorder window the note is held until a note more than the window
+ *   newer comes, or the window is full, and the held notes are dumped in
+ *   time order.  The notes of one CPU keep their order since their time
+ *   never goes back.  Returns the length of the note.
+ *
+ ****************************************************************************/
+
+static int trace_dump_note(FAR FILE *out, FAR uint8_t *p,
+                           FAR struct trace_dump_context_s *ctx)
+{
+  FAR struct note_common_s *note = (FAR struct note_common_s *)p;
+  uint64_t time = trace_dump_time(note);
+#if TRACE_DUMP_REORDER > 0
+  const uint64_t window = CONFIG_PYXIS_SYSMON_TRACE_REORDER_WINDOW * 1000ull;
+  FAR struct trace_dump_note_s *held;
+  int slot;
+  int i;
+
+  while (ctx->nnotes > 0 &&
+         (ctx->nnotes == TRACE_DUMP_REORDER ||
+          g_trace_notes[ctx->order[0]].time + window < time))
+    {
+      slot = ctx->order[0];
+      ctx->nnotes--;
+      memmove(ctx->order, ctx->order + 1, ctx->nnotes);
+      ctx->time = g_trace_notes[slot].time;
+      trace_dump_one(out, g_trace_notes[slot].data, ctx);
+    }
+
+  /* The free slot is the one no held note uses */
+
+  for (slot = 0; slot < TRACE_DUMP_REORDER; slot++)
+    {
+      for (i = 0; i < ctx->nnotes; i++)
+        {
+          if (ctx->order[i] == slot)
+            {
+              break;
+            }
+        }
+
+      if (i == ctx->nnotes)
+        {
+          break;
+        }
+    }
+
+  held = &g_trace_notes[slot];
+  held->time = time;
+  memcpy(held->data, p, note->nc_length);
+
+  /* After the notes of the same time, ahead of the newer ones */
+
+  for (i = ctx->nnotes; i > 0 && g_trace_notes[ctx->order[i - 1]].time >
+       time; i--)
+    {
+      ctx->order[i] = ctx->order[i - 1];
+    }
+
+  ctx->order[i] = slot;
+  ctx->nnotes++;
+#else
+  ctx->time = time;
+  trace_dump_one(out, p, ctx);
+#endif
+
+  return note->nc_length;
+}
+
+/****************************************************************************
+ * Name: trace_dump_flush
+ *
+ * Description:
+ *   Dump the notes still held in the reorder window.
+ *
+ ****************************************************************************/
+
+static void trace_dump_flush(FAR FILE *out,
+                             FAR struct trace_dump_context_s *ctx)
+{
+#if TRACE_DUMP_REORDER > 0
+  int i;
+
+  for (i = 0; i < ctx->nnotes; i++)
+    {
+      ctx->time = g_trace_notes[ctx->order[i]].time;
+      trace_dump_one(out, g_trace_notes[ctx->order[i]].data, ctx);
+    }
+
+  ctx->nnotes = 0;
+#endif
+}
+
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+
+/****************************************************************************
+ * Name: trace_dump_line_flush
+ ****************************************************************************/
+
+static void trace_dump_line_flush(void)
+{
+  if (g_trace_linelen > 0)
+    {
+      sysmon_sink_write(g_trace_line, g_trace_linelen);
+      g_trace_linelen = 0;
+    }
+}
+
+/****************************************************************************
+ * Name: trace_dump_line_vprintf
+ *
+ * Description:
+ *   Add to the console line and queue it once it ends with a newline.
+ *   Text too long to join the line is passed on to the sink, which cuts
+ *   it and counts the cut.
+ *
+ ****************************************************************************/
+
+static int trace_dump_line_vprintf(FAR const char *fmt, va_list ap)
+{
+  size_t room = sizeof(g_trace_line) - g_trace_linelen;
+  va_list copy;
+  int ret;
+
+  va_copy(copy, ap);
+  ret = vsnprintf(&g_trace_line[g_trace_linelen], room, fmt, copy);
+  va_end(copy);
+
+  if (ret < 0)
+    {
+      return ret;
+    }
+  else if ((size_t)ret >= room)
+    {
+      trace_dump_line_flush();
+      return sysmon_sink_vprintf(fmt, ap);
+    }
+
+  g_trace_linelen += ret;
+  if (g_trace_linelen > 0 && g_trace_line[g_trace_linelen - 1] == '\n')
+    {
+      trace_dump_line_flush();
+    }
+
+  return ret;
+}
+
+#endif /* CONFIG_PYXIS_SYSMON_SINK */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: sysmon_trace_printf
+ ****************************************************************************/
+
+void sysmon_trace_printf(FAR FILE *out, FAR const char *fmt, ...)
+{
+  va_list ap;
+  int ret;
+
+  va_start(ap, fmt);
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  /* The console output goes through the sink like the rest of sysmon */
+
+  if (out == stdout)
+    {
+      ret = trace_dump_line_vprintf(fmt, ap);
+    }
+  else
+#endif
+    {
+      ret = vfprintf(out, fmt, ap);
+    }
+
+  va_end(ap);
+
+  if (ret > 0)
+    {
+      g_trace_nbytes += ret;
+    }
+}
+
 /****************************************************************************
  * Name: trace_dump
  *
@@ -632,11 +1029,12 @@ static int trace_dump_one(FAR FILE *out,
  *
  ****************************************************************************/
 
-int sysmon_trace_dump(FAR FILE *out)
+ssize_t sysmon_trace_dump(FAR FILE *out)
 {
   struct trace_dump_context_s ctx;
   uint8_t tracedata[UCHAR_MAX];
   FAR uint8_t *p;
+  unsigned int mode = NOTERAM_MODE_OVERWRITE_DISABLE;
   int size;
   int ret;
   int fd;
@@ -652,6 +1050,13 @@ int sysmon_trace_dump(FAR FILE *out)
     }
 
   trace_dump_init_context(&ctx, fd);
+  g_trace_nbytes = 0;
+
+#ifdef CONFIG_PYXIS_SYSMON_TRACE_RATE
+  /* Before the read, which would end an overflow */
+
+  ioctl(fd, NOTERAM_GETMODE, (unsigned long)&mode);
+#endif
 
   /* Read and output all notes */
 
@@ -666,20 +1071,29 @@ int sysmon_trace_dump(FAR FILE *out)
       p = tracedata;
       do
         {
-          size = trace_dump_one(out, p, &ctx);
+          size = trace_dump_note(out, p, &ctx);
           p += size;
           ret -= size;
         }
       while (ret > 0);
     }
 
+  trace_dump_flush(out, &ctx);
+  sysmon_trace_period_report(out);
+  sysmon_trace_cpu_report(out);
+  sysmon_trace_heap_report(out);
+  sysmon_trace_idle_report(out);
+  sysmon_trace_rate_report(out, mode);
   trace_dump_fini_context(&ctx);
+#ifdef CONFIG_PYXIS_SYSMON_SINK
+  trace_dump_line_flush();
+#endif
 
   /* Close note */
 
   close(fd);
 
-  return ret;
+  return ret < 0 ? (ssize_t)ret : (ssize_t)g_trace_nbytes;
 }
 
 /****************************************************************************
@@ -729,3 +1143,213 @@ void sysmon_trace_dump_set_overwrite(bool enable)
 
   note_ioctl(NOTERAM_SETMODE, (unsigned long)&mode);
 }
+
+/****************************************************************************
+ * Name: sysmon_trace_count
+ ****************************************************************************/
+
+int sysmon_trace_count(pid_t pid, int type)
+{
+  FAR struct note_common_s *note;
+  uint8_t tracedata[UCHAR_MAX];
+  unsigned int mode = NOTERAM_MODE_OVERWRITE_DISABLE;
+  int count = 0;
+  int ret;
+  int fd;
+  int i;
+
+  fd = open("/dev/note", O_RDONLY);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  /* Before the read, which would end an overflow */
+
+  ioctl(fd, NOTERAM_GETMODE, (unsigned long)&mode);
+
+  while ((ret = read(fd, tracedata, sizeof tracedata)) > 0)
+    {
+      for (i = 0; i < ret; i += note->nc_length)
+        {
+          note = (FAR struct note_common_s *)&tracedata[i];
+          if (note->nc_length == 0)
+            {
+              break;
+            }
+
+          if (note->nc_type == type &&
+              note->nc_pid[0] + (note->nc_pid[1] << 8) == pid)
+            {
+              count++;
+            }
+        }
+    }
+
+  close(fd);
+
+  if (ret < 0)
+    {
+      return -errno;
+    }
+
+  return mode == NOTERAM_MODE_OVERWRITE_OVERFLOW ? -EOVERFLOW : count;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_task_find
+ ****************************************************************************/
+
+int sysmon_trace_task_find(FAR const struct sysmon_trace_task_s *tasks,
+                           pid_t pid)
+{
+  int i;
+
+  for (i = 0; i < SYSMON_TRACE_MAX_TASKS; i++)
+    {
+      if (tasks[i].used && !tasks[i].exited && tasks[i].pid == pid)
+        {
+          return i;
+        }
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_task_add
+ ****************************************************************************/
+
+int sysmon_trace_task_add(FAR struct sysmon_trace_task_s *tasks,
+                          pid_t pid, FAR const char *name)
+{
+  int i;
+
+  for (i = 0; i < SYSMON_TRACE_MAX_TASKS; i++)
+    {
+      if (!tasks[i].used)
+        {
+          tasks[i].used = true;
+          tasks[i].exited = false;
+          tasks[i].pid = pid;
+          strlcpy(tasks[i].name, name, sizeof(tasks[i].name));
+          return i;
+        }
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_task_exit
+ ****************************************************************************/
+
+void sysmon_trace_task_exit(FAR struct sysmon_trace_task_s *tasks,
+                            int slot)
+{
+  tasks[slot].exited = true;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_task_remove
+ ****************************************************************************/
+
+void sysmon_trace_task_remove(FAR struct sysmon_trace_task_s *tasks,
+                              int slot)
+{
+  tasks[slot].used = false;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_window_note
+ ****************************************************************************/
+
+void sysmon_trace_window_note(FAR struct sysmon_trace_window_s *window,
+                              uint64_t time)
+{
+  if (window->first == 0)
+    {
+      window->first = time;
+    }
+
+  if (time > window->last)
+    {
+      window->last = time;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_window_next
+ ****************************************************************************/
+
+void sysmon_trace_window_next(FAR struct sysmon_trace_window_s *window)
+{
+  window->first = window->last;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_decade
+ ****************************************************************************/
+
+int sysmon_trace_decade(uint64_t duration)
+{
+  uint64_t limit = 10 * NSEC_PER_USEC;
+  int decade = 0;
+
+  while (decade < SYSMON_TRACE_DECADES - 1 && duration >= limit)
+    {
+      limit *= 10;
+      decade++;
+    }
+
+  return decade;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_decade_name
+ ****************************************************************************/
+
+FAR const char *sysmon_trace_decade_name(int decade)
+{
+  return g_trace_decades[decade];
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_top
+ ****************************************************************************/
+
+void sysmon_trace_top(FAR void *base, size_t nmemb, size_t size,
+                      size_t ntop, CODE int (*compare)(FAR const void *,
+                                                       FAR const void *))
+{
+  FAR uint8_t *items = base;
+  FAR uint8_t *a;
+  FAR uint8_t *b;
+  uint8_t tmp;
+  size_t best;
+  size_t i;
+  size_t j;
+
+  /* A selection of the first few, the lists ranked are short */
+
+  for (i = 0; i < ntop && i < nmemb; i++)
+    {
+      best = i;
+      for (j = i + 1; j < nmemb; j++)
+        {
+          if (compare(items + j * size, items + best * size) < 0)
+            {
+              best = j;
+            }
+        }
+
+      a = items + i * size;
+      b = items + best * size;
+      for (j = 0; best != i && j < size; j++)
+        {
+          tmp = a[j];
+          a[j] = b[j];
+          b[j] = tmp;
+        }
+    }
+}
@@ -0,0 +1,560 @@
+/****************************************************************************
+ * apps/system/sysmon/trace_heap.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <nuttx/clock.h>
+#include <nuttx/sched_note.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_PYXIS_SYSMON_TRACE_HEAP_LIVE
+#  define CONFIG_PYXIS_SYSMON_TRACE_HEAP_LIVE 256
+#endif
+
+#define HEAP_LIVE          CONFIG_PYXIS_SYSMON_TRACE_HEAP_LIVE
+#define HEAP_CLASSES       14   /* Up to 16 bytes, then powers of two */
+#define HEAP_SIZES         32   /* Distinct sizes counted per window */
+#define HEAP_NTOP          5    /* Sizes and live blocks printed */
+#define HEAP_OTHERS        SYSMON_TRACE_MAX_TASKS
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* outstanding only counts the blocks of the live table, the others are
+ * counted apart since their free cannot be matched.
+ */
+
+struct heap_count_s
+{
+  uint32_t nallocs;             /* During the window */
+  uint32_t nfrees;
+  uint64_t allocated;           /* Bytes allocated during the window */
+  int64_t outstanding;          /* Bytes allocated and not freed yet */
+};
+
+/* A block allocated since the analysis started and not freed yet */
+
+struct heap_live_s
+{
+  FAR void *mem;                /* NULL if the slot is free */
+  uint64_t time;
+  uint32_t size;
+  int16_t task;                 /* Slot of the task charged */
+  uint8_t class;
+};
+
+struct heap_size_s
+{
+  uint32_t size;
+  uint32_t count;
+};
+
+struct heap_s
+{
+  struct sysmon_trace_window_s window;
+  uint32_t nlive;
+  uint32_t untracked;           /* Frees of blocks not in live */
+  uint32_t nspilled;            /* Allocations left out of live */
+  uint64_t spilled;             /* Their bytes */
+  uint32_t lifetimes[SYSMON_TRACE_DECADES];
+  uint32_t nsizes;
+  uint32_t othersizes;          /* Allocations of sizes past HEAP_SIZES */
+  struct heap_size_s sizes[HEAP_SIZES];
+  struct heap_count_s classes[HEAP_CLASSES];
+  struct sysmon_trace_task_s slots[SYSMON_TRACE_MAX_TASKS];
+
+  /* Allocations are charged to the task that made them, even when another
+   * task frees them.  HEAP_OTHERS collects the tasks without a slot.
+   */
+
+  struct heap_count_s tasks[SYSMON_TRACE_MAX_TASKS + 1];
+  uint32_t nblocks[SYSMON_TRACE_MAX_TASKS + 1];   /* Live blocks of each */
+  struct heap_live_s live[HEAP_LIVE];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct heap_s g_heap;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: heap_task
+ ****************************************************************************/
+
+static int heap_task(pid_t pid, FAR const char *name)
+{
+  int slot = sysmon_trace_task_find(g_heap.slots, pid);
+
+  if (slot >= 0)
+    {
+      return slot;
+    }
+
+  slot = sysmon_trace_task_add(g_heap.slots, pid, name);
+  if (slot < 0)
+    {
+      return HEAP_OTHERS;
+    }
+
+  memset(&g_heap.tasks[slot], 0, sizeof(g_heap.tasks[slot]));
+  return slot;
+}
+
+/****************************************************************************
+ * Name: heap_name
+ ****************************************************************************/
+
+static FAR const char *heap_name(int task)
+{
+  return task < HEAP_OTHERS ? g_heap.slots[task].name : "<others>";
+}
+
+/****************************************************************************
+ * Name: heap_class
+ ****************************************************************************/
+
+static int heap_class(size_t size)
+{
+  int class = 0;
+
+  while (class < HEAP_CLASSES - 1 && size > ((size_t)16 << class))
+    {
+      class++;
+    }
+
+  return class;
+}
+
+/****************************************************************************
+ * Name: heap_live
+ *
+ * Description:
+ *   Return the slot of mem in the live table, or the free slot to keep it
+ *   in, NULL if neither.  Linear probing, no deletion marks: a freed slot
+ *   is refilled by moving the following entries back.
+ *
+ ****************************************************************************/
+
+static FAR struct heap_live_s *heap_live(FAR void *mem)
+{
+  unsigned int slot = ((uintptr_t)mem >> 3) % HEAP_LIVE;
+  int i;
+
+  for (i = 0; i < HEAP_LIVE; i++)
+    {
+      FAR struct heap_live_s *live = &g_heap.live[(slot + i) % HEAP_LIVE];
+
+      if (live->mem == mem || live->mem == NULL)
+        {
+          return live;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: heap_unlive
+ ****************************************************************************/
+
+static void heap_unlive(FAR struct heap_live_s *live)
+{
+  unsigned int hole = live - g_heap.live;
+  unsigned int slot = hole;
+  unsigned int home;
+
+  live->mem = NULL;
+  g_heap.nlive--;
+  g_heap.nblocks[live->task]--;
+
+  /* Move back the entries that probed past the hole */
+
+  for (; ; )
+    {
+      slot = (slot + 1) % HEAP_LIVE;
+      if (g_heap.live[slot].mem == NULL)
+        {
+          break;
+        }
+
+      home = ((uintptr_t)g_heap.live[slot].mem >> 3) % HEAP_LIVE;
+      if ((slot > hole && (home <= hole || home > slot)) ||
+          (slot < hole && (home <= hole && home > slot)))
+        {
+          g_heap.live[hole] = g_heap.live[slot];
+          g_heap.live[slot].mem = NULL;
+          hole = slot;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: heap_size
+ ****************************************************************************/
+
+static void heap_size(uint32_t size)
+{
+  uint32_t i;
+
+  for (i = 0; i < g_heap.nsizes; i++)
+    {
+      if (g_heap.sizes[i].size == size)
+        {
+          g_heap.sizes[i].count++;
+          return;
+        }
+    }
+
+  if (g_heap.nsizes == HEAP_SIZES)
+    {
+      g_heap.othersizes++;
+      return;
+    }
+
+  g_heap.sizes[g_heap.nsizes].size = size;
+  g_heap.sizes[g_heap.nsizes++].count = 1;
+}
+
+/****************************************************************************
+ * Name: heap_alloc
+ ****************************************************************************/
+
+static void heap_alloc(uint64_t time, int task, FAR void *mem, size_t size)
+{
+  FAR struct heap_live_s *live;
+  int class = heap_class(size);
+
+  g_heap.tasks[task].nallocs++;
+  g_heap.tasks[task].allocated += size;
+  g_heap.classes[class].nallocs++;
+  g_heap.classes[class].allocated += size;
+  heap_size(size);
+
+  /* Past three quarters full the probes get long, the blocks left out
+   * are reported as untracked when freed.
+   */
+
+  live = heap_live(mem);
+  if (live == NULL ||
+      (live->mem == NULL && g_heap.nlive >= HEAP_LIVE * 3 / 4))
+    {
+      g_heap.nspilled++;
+      g_heap.spilled += size;
+      return;
+    }
+
+  if (live->mem == NULL)
+    {
+      g_heap.nlive++;
+    }
+  else
+    {
+      /* The free of the previous block there was not seen */
+
+      g_heap.nblocks[live->task]--;
+      g_heap.tasks[live->task].outstanding -= live->size;
+      g_heap.classes[live->class].outstanding -= live->size;
+    }
+
+  g_heap.nblocks[task]++;
+  g_heap.tasks[task].outstanding += size;
+  g_heap.classes[class].outstanding += size;
+
+  live->mem = mem;
+  live->time = time;
+  live->size = size;
+  live->task = task;
+  live->class = class;
+}
+
+/****************************************************************************
+ * Name: heap_free
+ ****************************************************************************/
+
+static void heap_free(uint64_t time, int task, FAR void *mem)
+{
+  FAR struct heap_live_s *live = heap_live(mem);
+
+  g_heap.tasks[task].nfrees++;
+
+  if (live == NULL || live->mem == NULL)
+    {
+      g_heap.untracked++;
+      return;
+    }
+
+  g_heap.tasks[live->task].outstanding -= live->size;
+  g_heap.classes[live->class].nfrees++;
+  g_heap.classes[live->class].outstanding -= live->size;
+  g_heap.lifetimes[sysmon_trace_decade(time - live->time)]++;
+  heap_unlive(live);
+}
+
+/****************************************************************************
+ * Name: heap_size_compare
+ ****************************************************************************/
+
+static int heap_size_compare(FAR const void *a, FAR const void *b)
+{
+  FAR const struct heap_size_s *sa = a;
+  FAR const struct heap_size_s *sb = b;
+
+  return sa->count > sb->count ? -1 : sa->count < sb->count;
+}
+
+/****************************************************************************
+ * Name: heap_rate
+ *
+ * Description:
+ *   Return count per second over the window, in tenths.
+ *
+ ****************************************************************************/
+
+static uint64_t heap_rate(uint64_t count)
+{
+  uint64_t window = g_heap.window.last - g_heap.window.first;
+
+  return window != 0 ? count * 10 * NSEC_PER_SEC / window : 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_note
+ ****************************************************************************/
+
+void sysmon_trace_heap_note(uint64_t time, int type, pid_t pid,
+                            FAR const char *name, FAR void *mem,
+                            size_t size)
+{
+  sysmon_trace_window_note(&g_heap.window, time);
+
+  switch (type)
+    {
+      case NOTE_HEAP_ALLOC:
+        heap_alloc(time, heap_task(pid, name), mem, size);
+        break;
+
+      case NOTE_HEAP_FREE:
+        heap_free(time, heap_task(pid, name), mem);
+        break;
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_exit
+ ****************************************************************************/
+
+void sysmon_trace_heap_exit(pid_t pid)
+{
+  int slot = sysmon_trace_task_find(g_heap.slots, pid);
+
+  if (slot >= 0)
+    {
+      sysmon_trace_task_exit(g_heap.slots, slot);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_heap_report
+ ****************************************************************************/
+
+void sysmon_trace_heap_report(FAR FILE *out)
+{
+  FAR struct heap_count_s *count;
+  FAR struct heap_live_s *top[HEAP_NTOP];
+  FAR struct heap_live_s *live;
+  uint64_t rate;
+  uint32_t nwindow = 0;
+  uint64_t bwindow = 0;
+  int ntop = 0;
+  int i;
+  int j;
+
+  if (g_heap.window.last == g_heap.window.first)
+    {
+      return;
+    }
+
+  sysmon_trace_printf(out, "Heap allocations (RATE per second):\n"
+                      "  PID   ALLOCS    RATE    FREES   ALLOCATED"
+                      " OUTSTANDING NAME\n");
+  for (i = 0; i <= HEAP_OTHERS; i++)
+    {
+      count = &g_heap.tasks[i];
+      if ((i < HEAP_OTHERS && !g_heap.slots[i].used) ||
+          (count->nallocs == 0 && count->nfrees == 0 &&
+           count->outstanding == 0))
+        {
+          continue;
+        }
+
+      rate = heap_rate(count->nallocs);
+      sysmon_trace_printf(out, "%5d %8" PRIu32 " %5" PRIu64 ".%" PRIu64
+                          " %8" PRIu32 " %11" PRIu64 " %11" PRId64 " %s\n",
+                          i < HEAP_OTHERS ? g_heap.slots[i].pid : -1,
+                          count->nallocs, rate / 10, rate % 10,
+                          count->nfrees, count->allocated,
+                          count->outstanding, heap_name(i));
+      count->nallocs = 0;
+      count->nfrees = 0;
+      count->allocated = 0;
+    }
+
+  sysmon_trace_printf(out, "    CLASS   ALLOCS    FREES   ALLOCATED"
+                      " OUTSTANDING\n");
+  for (i = 0; i < HEAP_CLASSES; i++)
+    {
+      count = &g_heap.classes[i];
+      if (count->nallocs == 0 && count->nfrees == 0 &&
+          count->outstanding == 0)
+        {
+          continue;
+        }
+
+      sysmon_trace_printf(out, "%s%7zu %8" PRIu32 " %8" PRIu32 " %11"
+                          PRIu64 " %11" PRId64 "\n",
+                          i < HEAP_CLASSES - 1 ? "<=" : " >",
+                          (size_t)16 << (i < HEAP_CLASSES - 1 ? i : i - 1),
+                          count->nallocs, count->nfrees, count->allocated,
+                          count->outstanding);
+      count->nallocs = 0;
+      count->nfrees = 0;
+      count->allocated = 0;
+    }
+
+  sysmon_trace_printf(out, "Lifetimes:");
+  for (i = 0; i < SYSMON_TRACE_DECADES; i++)
+    {
+      sysmon_trace_printf(out, " %s %" PRIu32, sysmon_trace_decade_name(i),
+                          g_heap.lifetimes[i]);
+      g_heap.lifetimes[i] = 0;
+    }
+
+  sysmon_trace_printf(out, ", untracked allocs %" PRIu32 " of %" PRIu64
+                      " bytes, untracked frees %" PRIu32 "\n",
+                      g_heap.nspilled, g_heap.spilled, g_heap.untracked);
+  g_heap.untracked = 0;
+  g_heap.nspilled = 0;
+  g_heap.spilled = 0;
+
+  sysmon_trace_top(g_heap.sizes, g_heap.nsizes, sizeof(g_heap.sizes[0]),
+                   HEAP_NTOP, heap_size_compare);
+  sysmon_trace_printf(out, "Top sizes:");
+  for (i = 0; i < HEAP_NTOP && i < g_heap.nsizes; i++)
+    {
+      sysmon_trace_printf(out, " %" PRIu32 "x%" PRIu32,
+                          g_heap.sizes[i].size, g_heap.sizes[i].count);
+    }
+
+  if (g_heap.othersizes != 0)
+    {
+      sysmon_trace_printf(out, ", %" PRIu32 " of other sizes",
+                          g_heap.othersizes);
+    }
+
+  sysmon_trace_printf(out, "\n");
+  g_heap.nsizes = 0;
+  g_heap.othersizes = 0;
+
+  /* The blocks allocated during the window and still live, the oldest
+   * first: the candidates for a leak.
+   */
+
+  for (i = 0; i < HEAP_LIVE; i++)
+    {
+      live = &g_heap.live[i];
+      if (live->mem == NULL || live->time < g_heap.window.first)
+        {
+          continue;
+        }
+
+      nwindow++;
+      bwindow += live->size;
+      for (j = ntop; j > 0 && top[j - 1]->time > live->time; j--)
+        {
+          if (j < HEAP_NTOP)
+            {
+              top[j] = top[j - 1];
+            }
+        }
+
+      if (j < HEAP_NTOP)
+        {
+          top[j] = live;
+          if (ntop < HEAP_NTOP)
+            {
+              ntop++;
+            }
+        }
+    }
+
+  sysmon_trace_printf(out, "Still live: %" PRIu32 " blocks, %" PRIu64
+                      " bytes\n", nwindow, bwindow);
+  for (i = 0; i < ntop; i++)
+    {
+      sysmon_trace_printf(out, "  %p %8" PRIu32 " bytes, %" PRIu64
+                          "us old, %s\n", top[i]->mem, top[i]->size,
+                          (g_heap.window.last - top[i]->time) /
+                          NSEC_PER_USEC, heap_name(top[i]->task));
+    }
+
+  sysmon_trace_printf(out, "\n");
+
+  /* An exited task keeps its slot while blocks it allocated are live, the
+   * frees of the untracked ones cannot be told.
+   */
+
+  for (i = 0; i < HEAP_OTHERS; i++)
+    {
+      if (g_heap.slots[i].exited && g_heap.nblocks[i] == 0)
+        {
+          sysmon_trace_task_remove(g_heap.slots, i);
+        }
+    }
+
+  sysmon_trace_window_next(&g_heap.window);
+}
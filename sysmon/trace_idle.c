@@ -0,0 +1,318 @@
+/****************************************************************************
+ * apps/system/sysmon/trace_idle.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <nuttx/clock.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+#  define NCPUS CONFIG_SMP_NCPUS
+#else
+#  define NCPUS 1
+#endif
+
+#define IDLE_SOURCES       32   /* Distinct wakeup sources per window */
+#define IDLE_NTOP          8    /* Wakeup sources printed */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* An idle period is the time a CPU sleeps in the idle task: it starts
+ * when the CPU switches to the idle task or leaves an interrupt handler
+ * there, and ends with the next interrupt or switch to a task.  Each end
+ * is a wakeup.
+ */
+
+struct idle_cpu_s
+{
+  bool known;                   /* A switch was seen, the state is valid */
+  bool idle;                    /* Running the idle task */
+  int nest;                     /* Interrupt nest level */
+  uint64_t since;               /* Start of the idle period, 0 if none */
+  uint64_t total;               /* Idle time during the window */
+  uint32_t nwakeups;
+  uint32_t hist[SYSMON_TRACE_DECADES]; /* Idle periods by length */
+};
+
+/* A wakeup source: an interrupt, or the task switched to when no
+ * interrupt is involved, e.g. woken from another CPU.
+ */
+
+struct idle_source_s
+{
+  int irq;                      /* -1 for a task */
+  pid_t pid;
+  uint32_t count;
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+};
+
+struct idle_s
+{
+  struct sysmon_trace_window_s window;
+  uint32_t nsources;
+  uint32_t others;              /* Wakeups of sources past IDLE_SOURCES */
+  struct idle_cpu_s cpus[NCPUS];
+  struct idle_source_s sources[IDLE_SOURCES];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct idle_s g_idle;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: idle_source
+ ****************************************************************************/
+
+static void idle_source(int irq, pid_t pid, FAR const char *name)
+{
+  FAR struct idle_source_s *source;
+  uint32_t i;
+
+  for (i = 0; i < g_idle.nsources; i++)
+    {
+      source = &g_idle.sources[i];
+      if (source->irq == irq && (irq >= 0 || source->pid == pid))
+        {
+          source->count++;
+          return;
+        }
+    }
+
+  if (g_idle.nsources == IDLE_SOURCES)
+    {
+      g_idle.others++;
+      return;
+    }
+
+  source = &g_idle.sources[g_idle.nsources++];
+  source->irq = irq;
+  source->pid = pid;
+  source->count = 1;
+  if (irq >= 0)
+    {
+      snprintf(source->name, sizeof(source->name), "irq%d", irq);
+    }
+  else
+    {
+      strlcpy(source->name, name, sizeof(source->name));
+    }
+}
+
+/****************************************************************************
+ * Name: idle_end
+ *
+ * Description:
+ *   End the idle period of cpu at time, if any, and count the wakeup.
+ *
+ ****************************************************************************/
+
+static bool idle_end(FAR struct idle_cpu_s *cpu, uint64_t time)
+{
+  uint64_t length;
+
+  if (cpu->since == 0)
+    {
+      return false;
+    }
+
+  length = time > cpu->since ? time - cpu->since : 0;
+  cpu->total += length;
+  cpu->hist[sysmon_trace_decade(length)]++;
+  cpu->nwakeups++;
+  cpu->since = 0;
+  return true;
+}
+
+/****************************************************************************
+ * Name: idle_source_compare
+ ****************************************************************************/
+
+static int idle_source_compare(FAR const void *a, FAR const void *b)
+{
+  FAR const struct idle_source_s *sa = a;
+  FAR const struct idle_source_s *sb = b;
+
+  return sa->count > sb->count ? -1 : sa->count < sb->count;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_switch
+ ****************************************************************************/
+
+void sysmon_trace_idle_switch(uint64_t time, int cpu, pid_t next,
+                              FAR const char *name)
+{
+  FAR struct idle_cpu_s *state = &g_idle.cpus[cpu];
+
+  sysmon_trace_window_note(&g_idle.window, time);
+  if (state->known && state->idle && next < NCPUS)
+    {
+      return;
+    }
+
+  /* A switch without an interrupt ending the idle period is a wakeup from
+   * another CPU, or by an interrupt that is not traced.
+   */
+
+  if (idle_end(state, time))
+    {
+      idle_source(-1, next, name);
+    }
+
+  state->known = true;
+  state->idle = next < NCPUS;
+  if (state->idle && state->nest == 0)
+    {
+      state->since = time;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_irq
+ ****************************************************************************/
+
+void sysmon_trace_idle_irq(uint64_t time, int cpu, int irq, bool enter)
+{
+  FAR struct idle_cpu_s *state = &g_idle.cpus[cpu];
+
+  sysmon_trace_window_note(&g_idle.window, time);
+
+  if (enter)
+    {
+      if (state->nest++ == 0 && idle_end(state, time))
+        {
+          idle_source(irq, -1, NULL);
+        }
+    }
+  else if (state->nest > 0 && --state->nest == 0 &&
+           state->known && state->idle)
+    {
+      /* Back to sleep.  A switch the handler caused was passed before this
+       * leave, the CPU is then no longer idle.
+       */
+
+      state->since = time;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_idle_report
+ ****************************************************************************/
+
+void sysmon_trace_idle_report(FAR FILE *out)
+{
+  FAR struct idle_cpu_s *state;
+  uint64_t last = g_idle.window.last;
+  uint64_t window = last - g_idle.window.first;
+  uint64_t rate;
+  uint32_t i;
+  int cpu;
+
+  if (window == 0)
+    {
+      return;
+    }
+
+  sysmon_trace_printf(out, "Idle residency:\n"
+                      "CPU  IDLE%%  WAKEUPS/s");
+  for (i = 0; i < SYSMON_TRACE_DECADES; i++)
+    {
+      sysmon_trace_printf(out, " %6s", sysmon_trace_decade_name(i));
+    }
+
+  sysmon_trace_printf(out, "\n");
+
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      state = &g_idle.cpus[cpu];
+
+      /* A period still in progress counts up to the end of the window */
+
+      if (state->since != 0 && last > state->since)
+        {
+          state->total += last - state->since;
+          state->since = last;
+        }
+
+      rate = (uint64_t)state->nwakeups * 10 * NSEC_PER_SEC / window;
+      sysmon_trace_printf(out, "%3d %5" PRIu64 " %8" PRIu64 ".%" PRIu64,
+                          cpu, state->total * 100 / window, rate / 10,
+                          rate % 10);
+      for (i = 0; i < SYSMON_TRACE_DECADES; i++)
+        {
+          sysmon_trace_printf(out, " %6" PRIu32, state->hist[i]);
+          state->hist[i] = 0;
+        }
+
+      sysmon_trace_printf(out, "\n");
+      state->total = 0;
+      state->nwakeups = 0;
+    }
+
+  sysmon_trace_top(g_idle.sources, g_idle.nsources,
+                   sizeof(g_idle.sources[0]), IDLE_NTOP,
+                   idle_source_compare);
+  sysmon_trace_printf(out, "Top wakeup sources:");
+  for (i = 0; i < IDLE_NTOP && i < g_idle.nsources; i++)
+    {
+      rate = (uint64_t)g_idle.sources[i].count * 10 * NSEC_PER_SEC / window;
+      sysmon_trace_printf(out, " %s %" PRIu64 ".%" PRIu64 "/s",
+                          g_idle.sources[i].name, rate / 10, rate % 10);
+    }
+
+  if (g_idle.others != 0)
+    {
+      sysmon_trace_printf(out, ", %" PRIu32 " from other sources",
+                          g_idle.others);
+    }
+
+  sysmon_trace_printf(out, "\n\n");
+
+  g_idle.nsources = 0;
+  g_idle.others = 0;
+  sysmon_trace_window_next(&g_idle.window);
+}
@@ -0,0 +1,491 @@
+/****************************************************************************
+ * apps/system/sysmon/trace_period.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <nuttx/clock.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+#  define NCPUS CONFIG_SMP_NCPUS
+#else
+#  define NCPUS 1
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRACE_PERIOD_SAMPLES
+#  define CONFIG_PYXIS_SYSMON_TRACE_PERIOD_SAMPLES 64
+#endif
+
+#define PERIOD_SAMPLES     CONFIG_PYXIS_SYSMON_TRACE_PERIOD_SAMPLES
+#define PERIOD_MIN_SAMPLES 4    /* Intervals needed to report a task */
+#define PERIOD_TOLERANCE   8    /* Cluster width, 1/8 of the period */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The statistics of the run times over a window */
+
+struct period_stat_s
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+};
+
+/* One task.  An activation starts when the task is switched in after it
+ * blocked and ends when it blocks again, preemptions in between are part
+ * of the same activation.
+ */
+
+struct period_task_s
+{
+  bool blocked;                 /* Waiting for its next activation */
+  bool started;                 /* Activated at least once */
+  uint64_t activation;          /* Start of the current activation */
+  uint64_t resumed;             /* Last switch in */
+  uint64_t run;                 /* Run time of the current activation */
+  uint32_t period;              /* Period found in the last window, us */
+  uint32_t missed;              /* Periods without an activation */
+  uint32_t nacts;               /* Intervals seen in the window */
+  struct period_stat_s runtime;
+  uint16_t nintervals;          /* Samples kept for the window */
+  uint16_t nruntimes;
+  uint32_t intervals[PERIOD_SAMPLES];
+  uint32_t runtimes[PERIOD_SAMPLES];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct sysmon_trace_task_s g_period_slots[SYSMON_TRACE_MAX_TASKS];
+static struct period_task_s g_period_tasks[SYSMON_TRACE_MAX_TASKS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: period_get
+ *
+ * Description:
+ *   Return the slot of task pid, taking a free one if name is not NULL,
+ *   -1 if none.
+ *
+ ****************************************************************************/
+
+static int period_get(pid_t pid, FAR const char *name)
+{
+  int slot = sysmon_trace_task_find(g_period_slots, pid);
+
+  if (slot >= 0 || name == NULL)
+    {
+      return slot;
+    }
+
+  slot = sysmon_trace_task_add(g_period_slots, pid, name);
+  if (slot >= 0)
+    {
+      memset(&g_period_tasks[slot], 0, sizeof(g_period_tasks[slot]));
+      g_period_tasks[slot].blocked = true;
+    }
+
+  return slot;
+}
+
+/****************************************************************************
+ * Name: period_keep
+ *
+ * Description:
+ *   Keep the count-th value of the window for the report.  Past
+ *   PERIOD_SAMPLES values the oldest kept one is overwritten.
+ *
+ ****************************************************************************/
+
+static void period_keep(FAR uint32_t *samples, FAR uint16_t *nsamples,
+                        uint32_t count, uint32_t value)
+{
+  samples[count % PERIOD_SAMPLES] = value;
+  if (*nsamples < PERIOD_SAMPLES)
+    {
+      (*nsamples)++;
+    }
+}
+
+/****************************************************************************
+ * Name: period_add
+ *
+ * Description:
+ *   Count one value in the statistics, which see all the values of the
+ *   window, not only those kept.
+ *
+ ****************************************************************************/
+
+static void period_add(FAR struct period_stat_s *stat, uint32_t value)
+{
+  if (stat->count == 0 || value < stat->min)
+    {
+      stat->min = value;
+    }
+
+  if (value > stat->max)
+    {
+      stat->max = value;
+    }
+
+  stat->count++;
+  stat->sum += value;
+}
+
+/****************************************************************************
+ * Name: period_missed
+ *
+ * Description:
+ *   Return the number of periods skipped by an interval, 0 when it is
+ *   less than one and a half period.
+ *
+ ****************************************************************************/
+
+static uint32_t period_missed(uint32_t interval, uint32_t period)
+{
+  if (period == 0 || interval < period + period / 2)
+    {
+      return 0;
+    }
+
+  return (interval + period / 2) / period - 1;
+}
+
+/****************************************************************************
+ * Name: period_sort
+ ****************************************************************************/
+
+static void period_sort(FAR uint32_t *values, int n)
+{
+  uint32_t value;
+  int i;
+  int j;
+
+  for (i = 1; i < n; i++)
+    {
+      value = values[i];
+      for (j = i; j > 0 && values[j - 1] > value; j--)
+        {
+          values[j] = values[j - 1];
+        }
+
+      values[j] = value;
+    }
+}
+
+/****************************************************************************
+ * Name: period_dominant
+ *
+ * Description:
+ *   Find the dominant period in the sorted intervals: the largest group of
+ *   intervals within 1/PERIOD_TOLERANCE of each other, and return its
+ *   median.  A missed activation or a burst only adds outliers, and a task
+ *   alternating between two rates reports the more frequent one.
+ *
+ ****************************************************************************/
+
+static uint32_t period_dominant(FAR const uint32_t *values, int n,
+                                FAR int *fit)
+{
+  int best = 0;
+  int first = 0;
+  int lo = 0;
+  int hi;
+
+  for (hi = 0; hi < n; hi++)
+    {
+      while (values[hi] - values[lo] > values[hi] / PERIOD_TOLERANCE)
+        {
+          lo++;
+        }
+
+      if (hi - lo + 1 > best)
+        {
+          best = hi - lo + 1;
+          first = lo;
+        }
+    }
+
+  *fit = best;
+  return values[first + best / 2];
+}
+
+/****************************************************************************
+ * Name: period_sqrt
+ ****************************************************************************/
+
+static uint32_t period_sqrt(uint64_t value)
+{
+  uint64_t bit = (uint64_t)1 << 62;
+  uint64_t root = 0;
+
+  while (bit > value)
+    {
+      bit >>= 2;
+    }
+
+  while (bit != 0)
+    {
+      if (value >= root + bit)
+        {
+          value -= root + bit;
+          root = (root >> 1) + bit;
+        }
+      else
+        {
+          root >>= 1;
+        }
+
+      bit >>= 2;
+    }
+
+  return root;
+}
+
+/****************************************************************************
+ * Name: period_jitter
+ *
+ * Description:
+ *   Return the RMS deviation of the intervals from the period and the
+ *   largest one in maxdev.  An interval that skipped periods is compared
+ *   to the multiple of the period it spans, the miss is counted apart.
+ *
+ ****************************************************************************/
+
+static uint32_t period_jitter(FAR const uint32_t *values, int n,
+                              uint32_t period, FAR uint32_t *maxdev)
+{
+  uint64_t sumsq = 0;
+  uint32_t ideal;
+  uint32_t dev;
+  int i;
+
+  *maxdev = 0;
+  for (i = 0; i < n; i++)
+    {
+      ideal = (period_missed(values[i], period) + 1) * period;
+      dev = values[i] > ideal ? values[i] - ideal : ideal - values[i];
+      if (dev > *maxdev)
+        {
+          *maxdev = dev;
+        }
+
+      sumsq += (uint64_t)dev * dev;
+    }
+
+  return period_sqrt(sumsq / n);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_trace_period_switch
+ ****************************************************************************/
+
+void sysmon_trace_period_switch(uint64_t time, pid_t prev, bool blocked,
+                                pid_t next, FAR const char *name)
+{
+  FAR struct period_task_s *task;
+  uint32_t value;
+  int slot;
+
+  /* The idle tasks are never periodic */
+
+  if (prev >= NCPUS && (slot = period_get(prev, NULL)) >= 0 &&
+      g_period_tasks[slot].resumed != 0)
+    {
+      task = &g_period_tasks[slot];
+
+      /* Notes of different CPUs may be slightly out of order */
+
+      if (time > task->resumed)
+        {
+          task->run += time - task->resumed;
+        }
+
+      task->resumed = 0;
+      if (blocked && !task->blocked)
+        {
+          value = task->run / NSEC_PER_USEC;
+          period_keep(task->runtimes, &task->nruntimes,
+                      task->runtime.count, value);
+          period_add(&task->runtime, value);
+          task->blocked = true;
+        }
+    }
+
+  if (next < NCPUS || (slot = period_get(next, name)) < 0)
+    {
+      return;
+    }
+
+  task = &g_period_tasks[slot];
+  task->resumed = time;
+  if (task->blocked)
+    {
+      if (task->started)
+        {
+          value = (time - task->activation) / NSEC_PER_USEC;
+          period_keep(task->intervals, &task->nintervals, task->nacts++,
+                      value);
+          task->missed += period_missed(value, task->period);
+        }
+
+      task->activation = time;
+      task->run = 0;
+      task->blocked = false;
+      task->started = true;
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_period_exit
+ ****************************************************************************/
+
+void sysmon_trace_period_exit(pid_t pid)
+{
+  int slot = period_get(pid, NULL);
+
+  if (slot >= 0)
+    {
+      sysmon_trace_task_remove(g_period_slots, slot);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_period_report
+ ****************************************************************************/
+
+void sysmon_trace_period_report(FAR FILE *out)
+{
+  FAR struct period_task_s *task;
+  uint32_t samples[PERIOD_SAMPLES];
+  uint32_t period;
+  uint32_t jitter;
+  uint32_t maxdev;
+  bool title = false;
+  int fit;
+  int n;
+  int i;
+  int j;
+
+  for (i = 0; i < SYSMON_TRACE_MAX_TASKS; i++)
+    {
+      task = &g_period_tasks[i];
+      if (!g_period_slots[i].used)
+        {
+          continue;
+        }
+
+      n = task->nintervals;
+      if (n >= PERIOD_MIN_SAMPLES)
+        {
+          if (!title)
+            {
+              sysmon_trace_printf(out, "Periodic tasks (us):\n"
+                                  "  PID   PERIOD FIT%%  ACTS MISS"
+                                  "   JITTER   MAXDEV   RUNMIN"
+                                  "   RUNAVG   RUNP90   RUNMAX NAME\n");
+              title = true;
+            }
+
+          memcpy(samples, task->intervals, n * sizeof(samples[0]));
+          period_sort(samples, n);
+          period = period_dominant(samples, n, &fit);
+
+          /* Without the period of the last window the misses could not
+           * be told on the fly, count them in the intervals kept.
+           */
+
+          if (task->period == 0)
+            {
+              for (j = 0; j < n; j++)
+                {
+                  task->missed += period_missed(samples[j], period);
+                }
+            }
+
+          jitter = period_jitter(samples, n, period, &maxdev);
+          sysmon_trace_printf(out, "%5d %8" PRIu32 " %4d %5" PRIu32
+                              " %4" PRIu32 " %8" PRIu32 " %8" PRIu32,
+                              g_period_slots[i].pid, period,
+                              fit * 100 / n, task->nacts,
+                              task->missed, jitter, maxdev);
+
+          n = task->nruntimes;
+          if (n > 0)
+            {
+              memcpy(samples, task->runtimes, n * sizeof(samples[0]));
+              period_sort(samples, n);
+              sysmon_trace_printf(out, " %8" PRIu32 " %8" PRIu64
+                                  " %8" PRIu32 " %8" PRIu32 " %s\n",
+                                  task->runtime.min,
+                                  task->runtime.sum / task->runtime.count,
+                                  samples[n * 9 / 10], task->runtime.max,
+                                  g_period_slots[i].name);
+            }
+          else
+            {
+              sysmon_trace_printf(out, " %8s %8s %8s %8s %s\n",
+                                  "-", "-", "-", "-",
+                                  g_period_slots[i].name);
+            }
+
+          task->period = period;
+        }
+
+      /* Start the next window, keeping the activation in progress */
+
+      memset(&task->runtime, 0, sizeof(task->runtime));
+      task->nacts = 0;
+      task->nintervals = 0;
+      task->nruntimes = 0;
+      task->missed = 0;
+    }
+
+  if (title)
+    {
+      sysmon_trace_printf(out, "\n");
+    }
+}
@@ -0,0 +1,418 @@
+/****************************************************************************
+ * apps/system/sysmon/trace_rate.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <nuttx/clock.h>
+#include <nuttx/sched_note.h>
+#include <nuttx/note/noteram_driver.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_DRIVERS_NOTERAM_BUFSIZE
+#  define CONFIG_DRIVERS_NOTERAM_BUFSIZE 2048
+#endif
+
+#ifndef CONFIG_PYXIS_SYSMON_TRACE_RATE_TARGET
+#  define CONFIG_PYXIS_SYSMON_TRACE_RATE_TARGET 2000
+#endif
+
+#define RATE_NTOP          8    /* Tasks printed */
+#define RATE_MIN_WINDOW    1000000  /* Shorter windows are not reported */
+#define RATE_OTHERS        SYSMON_TRACE_MAX_TASKS
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct rate_count_s
+{
+  uint32_t notes;
+  uint32_t bytes;
+};
+
+/* A family of notes enabled by one instrumentation option.  filter is
+ * the trace command that masks it at run time through the notectl filter
+ * mode, NULL if only the option can leave it out.
+ */
+
+struct rate_group_s
+{
+  FAR const char *name;
+  FAR const char *option;
+  FAR const char *filter;
+  uint8_t first;
+  uint8_t last;
+};
+
+struct rate_s
+{
+  struct sysmon_trace_window_s window;
+  struct rate_count_s total;
+  uint32_t ndumps;
+  uint32_t nincomplete;         /* Dumps that lost notes, count unknown */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct rate_group_s g_rate_groups[] =
+{
+  { "switch",   "SCHED_INSTRUMENTATION_SWITCH",     "trace mode -w",
+    NOTE_START, NOTE_RESUME },
+  { "cpu",      "SCHED_INSTRUMENTATION",            NULL,
+    NOTE_CPU_START, NOTE_CPU_RESUMED },
+  { "preempt",  "SCHED_INSTRUMENTATION_PREEMPTION", NULL,
+    NOTE_PREEMPT_LOCK, NOTE_PREEMPT_UNLOCK },
+  { "csection", "SCHED_INSTRUMENTATION_CSECTION",   NULL,
+    NOTE_CSECTION_ENTER, NOTE_CSECTION_LEAVE },
+  { "spinlock", "SCHED_INSTRUMENTATION_SPINLOCKS",  NULL,
+    NOTE_SPINLOCK_LOCK, NOTE_SPINLOCK_ABORT },
+  { "syscall",  "SCHED_INSTRUMENTATION_SYSCALL",    "trace mode -s",
+    NOTE_SYSCALL_ENTER, NOTE_SYSCALL_LEAVE },
+  { "irq",      "SCHED_INSTRUMENTATION_IRQHANDLER", "trace mode -i",
+    NOTE_IRQ_ENTER, NOTE_IRQ_LEAVE },
+  { "dump",     "SCHED_INSTRUMENTATION_DUMP",       "trace mode -d",
+    NOTE_DUMP_STRING, NOTE_DUMP_BINARY },
+#ifdef CONFIG_SCHED_INSTRUMENTATION_HEAP
+  { "heap",     "SCHED_INSTRUMENTATION_HEAP",       NULL,
+    NOTE_HEAP_ADD, NOTE_HEAP_FREE },
+#endif
+  { "other",    NULL,                               NULL,
+    0, UINT8_MAX },
+};
+
+#define RATE_GROUPS (sizeof(g_rate_groups) / sizeof(g_rate_groups[0]))
+
+static struct rate_s g_rate;
+static struct rate_count_s g_rate_counts[RATE_GROUPS];
+static struct sysmon_trace_task_s g_rate_slots[SYSMON_TRACE_MAX_TASKS];
+
+/* Notes per task, indexed like the slots.  RATE_OTHERS collects the tasks
+ * without a slot.
+ */
+
+static struct rate_count_s g_rate_tasks[SYSMON_TRACE_MAX_TASKS + 1];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: rate_task
+ ****************************************************************************/
+
+static FAR struct rate_count_s *rate_task(pid_t pid, FAR const char *name)
+{
+  int slot = sysmon_trace_task_find(g_rate_slots, pid);
+
+  if (slot >= 0)
+    {
+      return &g_rate_tasks[slot];
+    }
+
+  slot = sysmon_trace_task_add(g_rate_slots, pid, name);
+  if (slot < 0)
+    {
+      return &g_rate_tasks[RATE_OTHERS];
+    }
+
+  g_rate_tasks[slot].notes = 0;
+  g_rate_tasks[slot].bytes = 0;
+  return &g_rate_tasks[slot];
+}
+
+/****************************************************************************
+ * Name: rate_per_second
+ ****************************************************************************/
+
+static uint64_t rate_per_second(uint64_t count, uint64_t window)
+{
+  return count * NSEC_PER_SEC / window;
+}
+
+/****************************************************************************
+ * Name: rate_needed
+ *
+ * Description:
+ *   Return the buffer size holding the target window at rate bytes per
+ *   second, with a quarter of margin, in whole KB.
+ *
+ ****************************************************************************/
+
+static uint64_t rate_needed(uint64_t rate)
+{
+  uint64_t size = rate * CONFIG_PYXIS_SYSMON_TRACE_RATE_TARGET /
+                  MSEC_PER_SEC;
+
+  size += size / 4;
+  return (size + 1023) / 1024 * 1024;
+}
+
+/****************************************************************************
+ * Name: rate_print
+ ****************************************************************************/
+
+static void rate_print(FAR FILE *out, uint64_t window, bool overflow)
+{
+  FAR struct rate_count_s *count;
+  int top[RATE_NTOP];
+  uint64_t removed = 0;
+  uint64_t needed;
+  uint64_t rate;
+  bool used[RATE_GROUPS];
+  int ntop = 0;
+  int best;
+  int i;
+  int j;
+
+  rate = rate_per_second(g_rate.total.bytes, window);
+  sysmon_trace_printf(out, "Trace rate: %" PRIu32 " notes, %" PRIu32
+                      " bytes in %" PRIu64 "ms, %" PRIu64 " B/s%s\n",
+                      g_rate.total.notes, g_rate.total.bytes,
+                      window / (NSEC_PER_SEC / MSEC_PER_SEC), rate,
+                      overflow ? ", incomplete" : "");
+
+  sysmon_trace_printf(out, "GROUP       NOTES    BYTES      B/s SHARE\n");
+  for (i = 0; i < RATE_GROUPS; i++)
+    {
+      used[i] = g_rate_counts[i].bytes != 0;
+      if (!used[i])
+        {
+          continue;
+        }
+
+      sysmon_trace_printf(out, "%-8s %8" PRIu32 " %8" PRIu32 " %8" PRIu64
+                          " %4" PRIu32 "%%\n", g_rate_groups[i].name,
+                          g_rate_counts[i].notes, g_rate_counts[i].bytes,
+                          rate_per_second(g_rate_counts[i].bytes, window),
+                          g_rate_counts[i].bytes * 100 /
+                          g_rate.total.bytes);
+    }
+
+  /* The tasks producing the most, kept sorted on insertion */
+
+  for (i = 0; i <= RATE_OTHERS; i++)
+    {
+      count = &g_rate_tasks[i];
+      if ((i < RATE_OTHERS && !g_rate_slots[i].used) || count->bytes == 0)
+        {
+          continue;
+        }
+
+      for (j = ntop; j > 0 && g_rate_tasks[top[j - 1]].bytes < count->bytes;
+           j--)
+        {
+          if (j < RATE_NTOP)
+            {
+              top[j] = top[j - 1];
+            }
+        }
+
+      if (j < RATE_NTOP)
+        {
+          top[j] = i;
+          if (ntop < RATE_NTOP)
+            {
+              ntop++;
+            }
+        }
+    }
+
+  sysmon_trace_printf(out, "  PID    NOTES    BYTES      B/s NAME\n");
+  for (i = 0; i < ntop; i++)
+    {
+      count = &g_rate_tasks[top[i]];
+      sysmon_trace_printf(out, "%5d %8" PRIu32 " %8" PRIu32 " %8" PRIu64
+                          " %s\n",
+                          top[i] < RATE_OTHERS ?
+                          g_rate_slots[top[i]].pid : -1,
+                          count->notes, count->bytes,
+                          rate_per_second(count->bytes, window),
+                          top[i] < RATE_OTHERS ?
+                          g_rate_slots[top[i]].name : "<others>");
+    }
+
+  /* How long the buffer holds at this rate, and what it would take to
+   * hold the target capture window.
+   */
+
+  needed = rate_needed(rate);
+  sysmon_trace_printf(out, "Buffer %d bytes holds %" PRIu64 "ms, "
+                      "%" PRIu32 " of %" PRIu32 " dumps incomplete\n",
+                      CONFIG_DRIVERS_NOTERAM_BUFSIZE,
+                      rate != 0 ? (uint64_t)CONFIG_DRIVERS_NOTERAM_BUFSIZE *
+                      MSEC_PER_SEC / rate : 0,
+                      g_rate.nincomplete, g_rate.ndumps);
+  sysmon_trace_printf(out, "For %dms: DRIVERS_NOTERAM_BUFSIZE=%" PRIu64
+                      "\n", CONFIG_PYXIS_SYSMON_TRACE_RATE_TARGET, needed);
+
+  /* Or keep the buffer and filter out the biggest note families until
+   * the rest fits, at run time where notectl can, else in the build.
+   */
+
+  while (needed > CONFIG_DRIVERS_NOTERAM_BUFSIZE)
+    {
+      best = -1;
+      for (i = 0; i < RATE_GROUPS - 1; i++)
+        {
+          if (used[i] && (best < 0 ||
+              g_rate_counts[i].bytes > g_rate_counts[best].bytes))
+            {
+              best = i;
+            }
+        }
+
+      if (best < 0 || g_rate_counts[best].bytes == g_rate.total.bytes -
+          removed)
+        {
+          break;
+        }
+
+      used[best] = false;
+      removed += g_rate_counts[best].bytes;
+      needed = rate_needed(rate_per_second(g_rate.total.bytes - removed,
+                                           window));
+      if (g_rate_groups[best].filter != NULL)
+        {
+          sysmon_trace_printf(out, "  without %s (%s): %" PRIu64 "\n",
+                              g_rate_groups[best].name,
+                              g_rate_groups[best].filter, needed);
+        }
+      else
+        {
+          sysmon_trace_printf(out, "  without %s (%s=n): %" PRIu64 "\n",
+                              g_rate_groups[best].name,
+                              g_rate_groups[best].option, needed);
+        }
+    }
+
+  sysmon_trace_printf(out, "\n");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_note
+ ****************************************************************************/
+
+void sysmon_trace_rate_note(uint64_t time, int type, pid_t pid,
+                            FAR const char *name, size_t length)
+{
+  FAR struct rate_count_s *task;
+  int i;
+
+  sysmon_trace_window_note(&g_rate.window, time);
+
+  for (i = 0; i < RATE_GROUPS - 1; i++)
+    {
+      if (type >= g_rate_groups[i].first && type <= g_rate_groups[i].last)
+        {
+          break;
+        }
+    }
+
+  g_rate_counts[i].notes++;
+  g_rate_counts[i].bytes += length;
+  g_rate.total.notes++;
+  g_rate.total.bytes += length;
+
+  task = rate_task(pid, name);
+  task->notes++;
+  task->bytes += length;
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_exit
+ ****************************************************************************/
+
+void sysmon_trace_rate_exit(pid_t pid)
+{
+  int slot = sysmon_trace_task_find(g_rate_slots, pid);
+
+  if (slot >= 0)
+    {
+      sysmon_trace_task_exit(g_rate_slots, slot);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_trace_rate_report
+ ****************************************************************************/
+
+void sysmon_trace_rate_report(FAR FILE *out, int mode)
+{
+  uint64_t window = g_rate.window.last - g_rate.window.first;
+  bool overflow;
+  int i;
+
+  /* The buffer lost notes if it filled up without overwrite, or wrapped
+   * with overwrite.  The notes read then span less than the dump period
+   * but their rate is still right.
+   */
+
+  g_rate.ndumps++;
+  overflow = mode == NOTERAM_MODE_OVERWRITE_OVERFLOW ||
+             (mode == NOTERAM_MODE_OVERWRITE_ENABLE &&
+              g_rate.total.bytes + UCHAR_MAX >=
+              CONFIG_DRIVERS_NOTERAM_BUFSIZE);
+  if (overflow)
+    {
+      g_rate.nincomplete++;
+    }
+
+  if (window >= RATE_MIN_WINDOW)
+    {
+      rate_print(out, window, overflow);
+    }
+
+  /* The exited tasks had their last notes counted in this window */
+
+  for (i = 0; i < RATE_OTHERS; i++)
+    {
+      if (g_rate_slots[i].exited)
+        {
+          sysmon_trace_task_remove(g_rate_slots, i);
+        }
+    }
+
+  memset(g_rate_counts, 0, sizeof(g_rate_counts));
+  memset(g_rate_tasks, 0, sizeof(g_rate_tasks));
+  g_rate.total.notes = 0;
+  g_rate.total.bytes = 0;
+  sysmon_trace_window_next(&g_rate.window);
+}